@@ -0,0 +1,241 @@
+﻿#include "benchmark.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+thread_local quint64 t_allocations = 0;
+} // namespace
+
+#if defined(__GLIBC__)
+// glibc 下直接替换 malloc 系列函数，Qt 容器的分配也能统计到
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    ++t_allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    ++t_allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++t_allocations;
+    return __libc_realloc(ptr, size);
+}
+}
+#elif defined(_MSC_VER) && defined(_DEBUG)
+// MSVC Debug 运行库提供分配钩子，malloc 与 operator new 都会经过
+#include <crtdbg.h>
+
+namespace {
+int countAllocation(int type, void *, size_t, int, long, const unsigned char *, int)
+{
+    if (type == _HOOK_ALLOC || type == _HOOK_REALLOC)
+        ++t_allocations;
+    return TRUE;
+}
+
+const int s_allocHook = (_CrtSetAllocHook(countAllocation), 0);
+} // namespace
+#else
+void *operator new(std::size_t size)
+{
+    ++t_allocations;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    ++t_allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace Bench {
+using Clock = std::chrono::steady_clock;
+
+namespace {
+QVector<Case> &registry()
+{
+    static QVector<Case> instance;
+    return instance;
+}
+
+qint64 percentile(std::vector<quint32> &samples, double ratio)
+{
+    if (samples.empty())
+        return 0;
+    const size_t index = qMin(samples.size() - 1, size_t(double(samples.size()) * ratio));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+} // namespace
+
+void addCase(const Case &benchCase)
+{
+    registry().append(benchCase);
+}
+
+const QVector<Case> &cases()
+{
+    return registry();
+}
+
+quint64 allocationCount()
+{
+    return t_allocations;
+}
+
+qint64 clockOverhead()
+{
+    constexpr int kRounds = 100000;
+    const auto    start = Clock::now();
+    for (int i = 0; i < kRounds; ++i)
+        (void)Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / kRounds;
+}
+
+Result runCase(const Case &benchCase, int threads, qint64 callsPerThread)
+{
+    if (benchCase.setUp)
+        benchCase.setUp();
+
+    // 预热：填充缓存、完成延迟初始化
+    const qint64 warmUp = qMin<qint64>(callsPerThread / 10, 10000);
+    for (qint64 i = 0; i < warmUp; ++i)
+        benchCase.run();
+
+    // 延迟样本预先分配，计时区间内不产生额外分配
+    std::vector<std::vector<quint32>> latencies(size_t(threads), std::vector<quint32>(size_t(callsPerThread)));
+    std::vector<quint64>              allocations(size_t(threads), 0);
+    std::atomic<int>                  ready{0};
+    std::atomic<bool>                 go{false};
+
+    std::vector<std::thread> workers;
+    workers.reserve(size_t(threads));
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<quint32> &samples = latencies[size_t(t)];
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            const quint64 before = allocationCount();
+            for (qint64 i = 0; i < callsPerThread; ++i) {
+                const auto start = Clock::now();
+                benchCase.run();
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                samples[size_t(i)] = quint32(qMin<qint64>(elapsed, UINT32_MAX));
+            }
+            allocations[size_t(t)] = allocationCount() - before;
+        });
+    }
+
+    while (ready.load() < threads)
+        std::this_thread::yield();
+    QElapsedTimer timer;
+    timer.start();
+    go.store(true, std::memory_order_release);
+    for (std::thread &worker : workers)
+        worker.join();
+    if (benchCase.drain)
+        benchCase.drain();
+    const qint64 elapsed = qMax<qint64>(timer.nsecsElapsed(), 1);
+
+    if (benchCase.tearDown)
+        benchCase.tearDown();
+
+    std::vector<quint32> merged;
+    merged.reserve(size_t(threads) * size_t(callsPerThread));
+    quint64 totalAllocations = 0;
+    for (int t = 0; t < threads; ++t) {
+        merged.insert(merged.end(), latencies[size_t(t)].begin(), latencies[size_t(t)].end());
+        totalAllocations += allocations[size_t(t)];
+    }
+
+    Result result;
+    result.name = benchCase.name;
+    result.threads = threads;
+    result.calls = qint64(threads) * callsPerThread;
+    result.callsPerSecond = double(result.calls) * 1e9 / double(elapsed);
+    result.p50 = percentile(merged, 0.50);
+    result.p99 = percentile(merged, 0.99);
+    result.p999 = percentile(merged, 0.999);
+    result.allocationsPerCall = result.calls > 0 ? double(totalAllocations) / double(result.calls) : 0;
+    return result;
+}
+
+void printHeader()
+{
+    std::printf("%-44s %4s %14s %10s %10s %10s %12s\n",
+                "case",
+                "thr",
+                "calls/s",
+                "p50(ns)",
+                "p99(ns)",
+                "p999(ns)",
+                "allocs/call");
+}
+
+void printResult(const Result &result)
+{
+    std::printf("%-44s %4d %14.0f %10lld %10lld %10lld %12.2f\n",
+                result.name.toLocal8Bit().constData(),
+                result.threads,
+                result.callsPerSecond,
+                static_cast<long long>(result.p50),
+                static_cast<long long>(result.p99),
+                static_cast<long long>(result.p999),
+                result.allocationsPerCall);
+    std::fflush(stdout);
+}
+} // namespace Bench
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+/*
+* 日志性能基准：
+*   每个用例由 setUp/run/drain/tearDown 组成，run 在 1~32 个生产线程中并发执行，
+*   统计吞吐（calls/s）、单次调用延迟的 p50/p99/p999 以及每次调用的内存分配次数
+*   延迟包含一次 steady_clock 读取的开销，启动时会打印该开销供对照
+*   内存分配次数：glibc 下统计 malloc/calloc/realloc，MSVC Debug 版通过 CRT 分配钩子统计全部堆分配，
+*   两者都包含 Qt 容器的分配；其他情况只统计 operator new
+*
+*  用法：
+*   logging_benchmark [--filter 关键字] [--calls 每线程调用次数] [--threads 1,2,4,8,16,32]
+*/
+
+namespace Bench {
+struct Case
+{
+    QString               name;
+    std::function<void()> setUp;    // 计时前调用，可为空
+    std::function<void()> run;      // 被测调用，各生产线程并发执行
+    std::function<void()> drain;    // 计时结束前调用，等待异步写入完成，可为空
+    std::function<void()> tearDown; // 计时后调用，可为空
+};
+
+struct Result
+{
+    QString name;
+    int     threads = 0;
+    qint64  calls = 0;
+    double  callsPerSecond = 0;
+    qint64  p50 = 0; // 纳秒
+    qint64  p99 = 0;
+    qint64  p999 = 0;
+    double  allocationsPerCall = 0;
+};
+
+void                 addCase(const Case &benchCase);
+const QVector<Case> &cases();
+
+Result runCase(const Case &benchCase, int threads, qint64 callsPerThread);
+qint64 clockOverhead();
+
+void printHeader();
+void printResult(const Result &result);
+
+// 当前线程累计的内存分配次数
+quint64 allocationCount();
+
+// 注册日志相关用例，见 logcases.cpp
+void registerLoggingCases();
+
+// FastPatternLayout 与 PatternLayout 的差分校验，输出不一致时返回 false
+bool checkFastPatternLayout();
+} // namespace Bench
@@ -0,0 +1,442 @@
+﻿#include "benchmark.h"
+#include "asyncrollingfileappender.h"
+#include "batchdatabaseappender.h"
+#include "fastlogstream.h"
+#include "fastpatternlayout.h"
+#include "groupcommitfileappender.h"
+#include "jsonlayout.h"
+#include "loggercache.h"
+#include "loghelper.h"
+#include "log4qt/appenderskeleton.h"
+#include "log4qt/asyncappender.h"
+#include "log4qt/binarylayout.h"
+#include "log4qt/databaselayout.h"
+#include "log4qt/fileappender.h"
+#include "log4qt/logmanager.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/patternlayout.h"
+#include "log4qt/rollingfileappender.h"
+#include "log4qt/simplelayout.h"
+#include "log4qt/ttcclayout.h"
+#include "log4qt/xmllayout.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+LOG_CATEGORY(lcBench, "Bench")
+
+namespace Bench {
+using namespace Log4Qt;
+
+namespace {
+const QString kPattern = QStringLiteral("%d{yyyy-MM-dd hh:mm:ss.zzz} [%-5p] %c - %m%n");
+const QString kPlainMessage = QStringLiteral("request 42 finished in 12 ms");
+
+// 只做格式化不落盘的 Appender，用于单独衡量 Layout 与日志框架本身的开销
+// （不是 log4j 的 NullAppender：每条事件都会经过 Layout 格式化；log4qt 没有提供 NullAppender）
+class FormatOnlyAppender : public AppenderSkeleton
+{
+public:
+    explicit FormatOnlyAppender(const LayoutSharedPtr &layout = LayoutSharedPtr())
+        : AppenderSkeleton(false)
+    {
+        setLayout(layout);
+        activateOptions();
+    }
+
+    bool requiresLayout() const override { return false; }
+
+protected:
+    void append(const LoggingEvent &event) override
+    {
+        // 调用方已持有 mObjectGuard
+        if (const LayoutSharedPtr layout = this->layout())
+            m_formatted += layout->format(event).size();
+    }
+
+private:
+    qint64 m_formatted = 0;
+};
+
+// 直接丢弃事件的 Appender，相当于 log4j 的 NullAppender，只衡量 logger 到 Appender 的分发开销
+class DiscardAppender : public AppenderSkeleton
+{
+public:
+    DiscardAppender()
+        : AppenderSkeleton(false)
+    {
+        activateOptions();
+    }
+
+    bool requiresLayout() const override { return false; }
+
+protected:
+    void append(const LoggingEvent &) override {}
+};
+
+QTemporaryDir &workDir()
+{
+    static QTemporaryDir dir;
+    return dir;
+}
+
+QString logFile(const QString &name)
+{
+    return workDir().filePath(name);
+}
+
+Logger *benchLogger()
+{
+    return LogManager::logger(QStringLiteral("Bench"));
+}
+
+Logger *helperLogger()
+{
+    return LogManager::logger(QStringLiteral("FEMLogger"));
+}
+
+void attach(Logger *logger, const AppenderSharedPtr &appender, Level level)
+{
+    logger->removeAllAppenders();
+    logger->setAdditivity(false);
+    logger->setLevel(level);
+    if (appender)
+        logger->addAppender(appender);
+    Log::LogCategory::invalidateAll();
+}
+
+void detach(Logger *logger)
+{
+    const QList<AppenderSharedPtr> appenders = logger->appenders();
+    logger->removeAllAppenders();
+    for (const AppenderSharedPtr &appender : appenders)
+        appender->close();
+    Log::LogCategory::invalidateAll();
+}
+
+LayoutSharedPtr patternLayout()
+{
+    return LayoutSharedPtr(new PatternLayout(kPattern));
+}
+
+// 把 makeAppender 创建的 Appender 挂到 logger 上，run 为被测调用
+void addLoggerCase(const QString                             &name,
+                   Logger                                    *logger,
+                   Level                                      level,
+                   const std::function<AppenderSharedPtr()> &makeAppender,
+                   const std::function<void()>               &run)
+{
+    auto current = std::make_shared<AppenderSharedPtr>();
+    Case benchCase;
+    benchCase.name = name;
+    benchCase.setUp = [logger, level, makeAppender, current]() {
+        *current = makeAppender();
+        attach(logger, *current, level);
+    };
+    benchCase.run = run;
+    benchCase.drain = [logger]() { detach(logger); };
+    benchCase.tearDown = [current]() {
+        current->clear();
+        for (const QString &file : QDir(workDir().path()).entryList(QDir::Files))
+            QFile::remove(workDir().filePath(file));
+    };
+    addCase(benchCase);
+}
+
+void registerLoggerCases()
+{
+    Logger *logger = benchLogger();
+    auto    formatOnly = []() { return AppenderSharedPtr(new FormatOnlyAppender(patternLayout())); };
+
+    addLoggerCase(QStringLiteral("logger/enabled/format-only"),
+                  logger,
+                  Level(Level::DEBUG_INT),
+                  formatOnly,
+                  [logger]() { logger->info(kPlainMessage); });
+    addLoggerCase(QStringLiteral("logger/disabled/format-only"),
+                  logger,
+                  Level(Level::WARN_INT),
+                  formatOnly,
+                  [logger]() { logger->debug(kPlainMessage); });
+}
+
+void registerMacroCases()
+{
+    Logger *helper = helperLogger();
+    auto    formatOnly = []() { return AppenderSharedPtr(new FormatOnlyAppender(patternLayout())); };
+
+    addLoggerCase(QStringLiteral("macro/LOGINFO/enabled"), helper, Level(Level::DEBUG_INT), formatOnly, []() {
+        LOGINFO("request %1 finished in %2 ms", 42, 12);
+    });
+    // 与上一项对比：QString 模板需先构造字符串，字面量走 UTF-8 直接格式化
+    addLoggerCase(QStringLiteral("macro/LOGINFO/enabled(QString)"),
+                  helper,
+                  Level(Level::DEBUG_INT),
+                  formatOnly,
+                  []() { LOGINFO(QStringLiteral("request %1 finished in %2 ms"), 42, 12); });
+    addLoggerCase(QStringLiteral("macro/LOGDEBUG/disabled"), helper, Level(Level::INFO_INT), formatOnly, []() {
+        LOGDEBUG("request %1 finished in %2 ms", 42, 12);
+    });
+    addLoggerCase(QStringLiteral("macro/LOGI(category)/enabled"),
+                  benchLogger(),
+                  Level(Level::DEBUG_INT),
+                  formatOnly,
+                  []() { LOGI(lcBench, "request %1 finished in %2 ms", 42, 12); });
+    addLoggerCase(QStringLiteral("macro/LOGD(category)/disabled"),
+                  benchLogger(),
+                  Level(Level::INFO_INT),
+                  formatOnly,
+                  []() { LOGD(lcBench, "request %1 finished in %2 ms", 42, 12); });
+
+    // 流式写法：log4qt 的 LogStream 与栈缓冲的 FastLogStream
+    addLoggerCase(QStringLiteral("stream/LogStream/enabled"),
+                  benchLogger(),
+                  Level(Level::DEBUG_INT),
+                  formatOnly,
+                  []() { lcBench().logger()->info() << "request " << 42 << " finished in " << 12.5 << " ms"; });
+    addLoggerCase(QStringLiteral("stream/FastLogStream/enabled"),
+                  benchLogger(),
+                  Level(Level::DEBUG_INT),
+                  formatOnly,
+                  []() { LOGSI(lcBench) << "request " << 42 << " finished in " << 12.5 << " ms"; });
+    addLoggerCase(QStringLiteral("stream/FastLogStream/disabled"),
+                  benchLogger(),
+                  Level(Level::INFO_INT),
+                  formatOnly,
+                  []() { LOGSD(lcBench) << "request " << 42 << " finished in " << 12.5 << " ms"; });
+}
+
+void registerLookupCases()
+{
+    // 每次调用按名称查找 logger，多线程下对比 Hierarchy 的读写锁与无锁缓存
+    static const QStringList names = []() {
+        QStringList list;
+        for (int i = 0; i < 64; ++i)
+            list.append(QStringLiteral("Bench.Lookup.%1").arg(i));
+        return list;
+    }();
+
+    Case hierarchy;
+    hierarchy.name = QStringLiteral("lookup/Logger::logger");
+    hierarchy.run = []() {
+        thread_local int next = 0;
+        Logger::logger(names.at(next++ & 63));
+    };
+    addCase(hierarchy);
+
+    Case cache;
+    cache.name = QStringLiteral("lookup/LoggerCache");
+    cache.run = []() {
+        thread_local int next = 0;
+        Log::LoggerCache::logger(names.at(next++ & 63));
+    };
+    addCase(cache);
+}
+
+void registerLayoutCases()
+{
+    const QList<QPair<QString, std::function<Layout *()>>> layouts = {
+        {QStringLiteral("PatternLayout"), []() -> Layout * { return new PatternLayout(kPattern); }},
+        {QStringLiteral("TTCCLayout"), []() -> Layout * { return new TTCCLayout; }},
+        {QStringLiteral("SimpleLayout"), []() -> Layout * { return new SimpleLayout; }},
+        {QStringLiteral("XMLLayout"), []() -> Layout * { return new XMLLayout; }},
+        {QStringLiteral("BinaryLayout"), []() -> Layout * { return new BinaryLayout; }},
+        {QStringLiteral("Log::FastPatternLayout"), []() -> Layout * { return new Log::FastPatternLayout(kPattern); }},
+        {QStringLiteral("Log::JsonLayout"), []() -> Layout * { return new Log::JsonLayout; }},
+    };
+
+    Logger *logger = benchLogger();
+    for (const auto &layout : layouts) {
+        const std::function<Layout *()> makeLayout = layout.second;
+        addLoggerCase(
+            QStringLiteral("layout/%1").arg(layout.first),
+            logger,
+            Level(Level::DEBUG_INT),
+            [makeLayout]() {
+                LayoutSharedPtr instance(makeLayout());
+                instance->activateOptions();
+                return AppenderSharedPtr(new FormatOnlyAppender(instance));
+            },
+            [logger]() { logger->info(kPlainMessage); });
+    }
+}
+
+void registerAppenderCases()
+{
+    const QList<QPair<QString, std::function<AppenderSharedPtr()>>> appenders = {
+        {QStringLiteral("discard"), []() { return AppenderSharedPtr(new DiscardAppender); }},
+        {QStringLiteral("format-only"), []() { return AppenderSharedPtr(new FormatOnlyAppender(patternLayout())); }},
+        {QStringLiteral("FileAppender"),
+         []() {
+             auto *appender = new FileAppender(patternLayout(), logFile(QStringLiteral("file.log")), true);
+             appender->activateOptions();
+             return AppenderSharedPtr(appender);
+         }},
+        {QStringLiteral("RollingFileAppender"),
+         []() {
+             auto *appender = new RollingFileAppender(patternLayout(), logFile(QStringLiteral("rolling.log")), true);
+             appender->setMaxFileSize(QStringLiteral("10MB"));
+             appender->setMaxBackupIndex(3);
+             appender->activateOptions();
+             return AppenderSharedPtr(appender);
+         }},
+        {QStringLiteral("AsyncAppender(FileAppender)"),
+         []() {
+             auto *file = new FileAppender(patternLayout(), logFile(QStringLiteral("async.log")), true);
+             file->activateOptions();
+             auto *appender = new AsyncAppender;
+             appender->addAppender(AppenderSharedPtr(file));
+             appender->activateOptions();
+             return AppenderSharedPtr(appender);
+         }},
+        {QStringLiteral("Log::GroupCommitFileAppender"),
+         []() {
+             auto *appender = new Log::GroupCommitFileAppender(patternLayout(), logFile(QStringLiteral("group.log")));
+             appender->activateOptions();
+             return AppenderSharedPtr(appender);
+         }},
+        {QStringLiteral("Log::AsyncRollingFileAppender"),
+         []() {
+             auto *appender = new Log::AsyncRollingFileAppender;
+             appender->setLayout(patternLayout());
+             appender->setFile(logFile(QStringLiteral("asyncrolling.log")));
+             appender->setMaxFileSize(QStringLiteral("10MB"));
+             appender->setMaxBackupIndex(3);
+             appender->activateOptions();
+             return AppenderSharedPtr(appender);
+         }},
+    };
+
+    Logger *logger = benchLogger();
+    for (const auto &appender : appenders) {
+        addLoggerCase(QStringLiteral("appender/%1").arg(appender.first),
+                      logger,
+                      Level(Level::DEBUG_INT),
+                      appender.second,
+                      [logger]() { logger->info(kPlainMessage); });
+    }
+}
+
+// 本地 SQLite 文件上的批量写入，连接需在 Appender 激活前创建、关闭后移除
+void registerDatabaseCases()
+{
+    const QString connection = QStringLiteral("bench");
+    Logger       *logger = benchLogger();
+
+    Case benchCase;
+    benchCase.name = QStringLiteral("appender/Log::BatchDatabaseAppender(SQLite)");
+    benchCase.setUp = [logger, connection]() {
+        QSqlDatabase database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connection);
+        database.setDatabaseName(logFile(QStringLiteral("log.db")));
+        database.open();
+        QSqlQuery(database).exec(QStringLiteral(
+            "CREATE TABLE log (time TEXT, level TEXT, logger TEXT, thread TEXT, message TEXT)"));
+
+        auto *layout = new DatabaseLayout;
+        layout->setTimeStampColumn(QStringLiteral("time"));
+        layout->setLevelColumn(QStringLiteral("level"));
+        layout->setLoggenameColumn(QStringLiteral("logger"));
+        layout->setThreadNameColumn(QStringLiteral("thread"));
+        layout->setMessageColumn(QStringLiteral("message"));
+        auto *appender =
+            new Log::BatchDatabaseAppender(LayoutSharedPtr(layout), QStringLiteral("log"), connection);
+        appender->activateOptions();
+        attach(logger, AppenderSharedPtr(appender), Level(Level::DEBUG_INT));
+    };
+    benchCase.run = [logger]() { logger->info(kPlainMessage); };
+    benchCase.drain = [logger]() { detach(logger); };
+    benchCase.tearDown = [connection]() {
+        QSqlDatabase::database(connection, false).close();
+        QSqlDatabase::removeDatabase(connection);
+        for (const QString &file : QDir(workDir().path()).entryList(QDir::Files))
+            QFile::remove(workDir().filePath(file));
+    };
+    addCase(benchCase);
+}
+
+// 差分校验用的事件：覆盖有/无调用位置、MDC、NDC、长消息与不同级别
+std::vector<LoggingEvent> checkEvents()
+{
+    const qint64  now = QDateTime::currentMSecsSinceEpoch();
+    const Logger *logger = benchLogger();
+    const QString longText(300, QLatin1Char('y'));
+
+    std::vector<LoggingEvent> events;
+    events.emplace_back(logger,
+                        Level(Level::INFO_INT),
+                        kPlainMessage,
+                        QStringLiteral("session-7"),
+                        QHash<QString, QString>{{QStringLiteral("requestId"), QStringLiteral("abc")}},
+                        QStringLiteral("worker"),
+                        now,
+                        MessageContext("bench.cpp", 77, "void bench()"),
+                        QString());
+    events.emplace_back(logger,
+                        Level(Level::FATAL_INT),
+                        longText,
+                        QString(),
+                        QHash<QString, QString>(),
+                        QString(),
+                        now + 999,
+                        MessageContext(),
+                        QString());
+    events.emplace_back(logger, Level(Level::TRACE_INT), QString::fromUtf8("中文消息 \xF0\x9F\x98\x80"));
+    return events;
+}
+} // namespace
+
+void registerLoggingCases()
+{
+    // LogHelper 初始化会读取 log.conf，先完成初始化再替换各 logger 的 Appender
+    Log::LogHelper::instance();
+
+    registerMacroCases();
+    registerLoggerCases();
+    registerLookupCases();
+    registerLayoutCases();
+    registerAppenderCases();
+    registerDatabaseCases();
+}
+
+bool checkFastPatternLayout()
+{
+    const QStringList patterns = {
+        kPattern,
+        QStringLiteral("%-5p %c [%t] %x %X{requestId} - %m%n"),
+        QStringLiteral("%r %F:%L %M %m%n"),
+        QStringLiteral("%d{ISO8601} %m%n"),
+        QStringLiteral("%d{ABSOLUTE} %-20.30c %10.5m|%n"),
+        QStringLiteral("%d{dd.MM.yyyy hh:mm} %%literal%% %p%n"),
+        QStringLiteral("%c{1} %X %m"),
+    };
+    const std::vector<LoggingEvent> events = checkEvents();
+
+    bool match = true;
+    for (const QString &pattern : patterns) {
+        Log::FastPatternLayout fast(pattern);
+        PatternLayout          reference(pattern);
+        for (const LoggingEvent &event : events) {
+            const QString expected = reference.format(event);
+            const QString actual = fast.format(event);
+            if (actual != expected) {
+                match = false;
+                std::printf("FastPatternLayout mismatch for '%s':\n  expected: %s\n  actual:   %s\n",
+                            pattern.toLocal8Bit().constData(),
+                            expected.toLocal8Bit().constData(),
+                            actual.toLocal8Bit().constData());
+            }
+        }
+        std::printf("FastPatternLayout '%s': %s\n",
+                    pattern.toLocal8Bit().constData(),
+                    fast.isCompiled() ? "compiled" : "fallback");
+    }
+    return match;
+}
+} // namespace Bench
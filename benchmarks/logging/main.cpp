@@ -0,0 +1,40 @@
+﻿#include "benchmark.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption filterOption(QStringLiteral("filter"), QStringLiteral("只运行名称包含该关键字的用例"), QStringLiteral("text"));
+    const QCommandLineOption callsOption(QStringLiteral("calls"), QStringLiteral("每个线程的调用次数"), QStringLiteral("count"), QStringLiteral("200000"));
+    const QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("生产线程数列表"), QStringLiteral("list"), QStringLiteral("1,2,4,8,16,32"));
+    parser.addOption(filterOption);
+    parser.addOption(callsOption);
+    parser.addOption(threadsOption);
+    parser.process(app);
+
+    const QString filter = parser.value(filterOption);
+    const qint64  calls = qMax<qint64>(1, parser.value(callsOption).toLongLong());
+    QVector<int>  threadCounts;
+    for (const QString &item : parser.value(threadsOption).split(QLatin1Char(','), Qt::SkipEmptyParts))
+        threadCounts.append(qBound(1, item.trimmed().toInt(), 256));
+
+    const bool layoutsMatch = Bench::checkFastPatternLayout();
+
+    Bench::registerLoggingCases();
+    std::printf("clock overhead: %lld ns per sample\n", static_cast<long long>(Bench::clockOverhead()));
+    Bench::printHeader();
+    for (const Bench::Case &benchCase : Bench::cases()) {
+        if (!filter.isEmpty() && !benchCase.name.contains(filter))
+            continue;
+        for (const int threads : qAsConst(threadCounts))
+            Bench::printResult(Bench::runCase(benchCase, threads, calls));
+    }
+    return layoutsMatch ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+﻿#include <QtCore/QString>
+
+#include "obj_conv/reflex_format.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+/*
+* reflexjson 读取性能基准：
+*   60 个字段的结构体（另有一个派生字段），分别用 JsonReader（DOM）与 json_to_obj（JsonSaxReader）反复读取，
+*   覆盖键按声明顺序、逆序、穿插未绑定的键以及缺少部分键几种输入，输出每种输入读取 count 次的耗时
+*
+*  用法：reflexjson_benchmark [count]（默认 2000）
+*/
+
+using namespace reflexjson;
+
+namespace {
+struct Wide
+{
+    int f0 = -1;
+    int f1 = -1;
+    int f2 = -1;
+    int f3 = -1;
+    int f4 = -1;
+    int f5 = -1;
+    int f6 = -1;
+    int f7 = -1;
+    int f8 = -1;
+    int f9 = -1;
+    int f10 = -1;
+    int f11 = -1;
+    int f12 = -1;
+    int f13 = -1;
+    int f14 = -1;
+    int f15 = -1;
+    int f16 = -1;
+    int f17 = -1;
+    int f18 = -1;
+    int f19 = -1;
+    int f20 = -1;
+    int f21 = -1;
+    int f22 = -1;
+    int f23 = -1;
+    int f24 = -1;
+    int f25 = -1;
+    int f26 = -1;
+    int f27 = -1;
+    int f28 = -1;
+    int f29 = -1;
+    int f30 = -1;
+    int f31 = -1;
+    int f32 = -1;
+    int f33 = -1;
+    int f34 = -1;
+    int f35 = -1;
+    int f36 = -1;
+    int f37 = -1;
+    int f38 = -1;
+    int f39 = -1;
+    int f40 = -1;
+    int f41 = -1;
+    int f42 = -1;
+    int f43 = -1;
+    int f44 = -1;
+    int f45 = -1;
+    int f46 = -1;
+    int f47 = -1;
+    int f48 = -1;
+    int f49 = -1;
+    int f50 = -1;
+    int f51 = -1;
+    int f52 = -1;
+    int f53 = -1;
+    int f54 = -1;
+    int f55 = -1;
+    int f56 = -1;
+    int f57 = -1;
+    int f58 = -1;
+    int f59 = -1;
+
+    REFLEX_BIND(O(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21,
+                  f22, f23, f24, f25, f26, f27, f28, f29, f30, f31, f32, f33, f34, f35, f36, f37, f38, f39, f40, f41,
+                  f42, f43, f44, f45, f46, f47, f48, f49, f50, f51, f52, f53, f54, f55, f56, f57, f58, f59))
+};
+
+struct Derived : Wide
+{
+    int extra = 0;
+
+    REFLEX_BIND(I(Wide), O(extra))
+};
+
+enum Layout
+{
+    InOrder = 0,
+    Reversed = 1,
+    Interleaved = 2,
+    Sparse = 4
+};
+
+std::string makeJson(int layout)
+{
+    std::string json = "{";
+    for (int k = 0; k < 60; ++k) {
+        const int index = (layout & Reversed) ? 59 - k : k;
+        if ((layout & Sparse) && index % 7 == 3)
+            continue;
+        json += "\"f" + std::to_string(index) + "\":" + std::to_string(index) + ',';
+        if (layout & Interleaved)
+            json += "\"unbound" + std::to_string(index) + "\":[1,{\"a\":2}],";
+    }
+    return json + "\"extra\":5}";
+}
+
+double elapsed(int count, const std::function<void()> &load)
+{
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        load();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+    const struct
+    {
+        const char *name;
+        int         layout;
+    } inputs[] = {
+        {"in order", InOrder},
+        {"reversed", Reversed},
+        {"interleaved", Interleaved},
+        {"in order, sparse", Sparse},
+        {"reversed, interleaved", Reversed | Interleaved},
+    };
+
+    std::printf("%-24s %12s %12s\n", "input", "dom (ms)", "sax (ms)");
+    for (const auto &input : inputs) {
+        const std::string json = makeJson(input.layout);
+        const double      dom = elapsed(count, [&json]() {
+            Derived    obj;
+            JsonReader reader(json);
+            reader.convert(nullptr, obj);
+        });
+        const double      sax = elapsed(count, [&json]() {
+            Derived obj;
+            json_to_obj(json, obj);
+        });
+        std::printf("%-24s %12.2f %12.2f\n", input.name, dom, sax);
+    }
+    return 0;
+}
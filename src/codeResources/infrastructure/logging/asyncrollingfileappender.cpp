@@ -0,0 +1,398 @@
+﻿#include "asyncrollingfileappender.h"
+#include "logindexreader.h"
+#include "log4qt/helpers/optionconverter.h"
+#include "log4qt/layout.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <array>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+const QString kStagingSuffix = QStringLiteral(".rolling");
+const QString kGzipSuffix = QStringLiteral(".gz");
+constexpr int kGzipChunkSize = 4 * 1024 * 1024;
+
+QString idx(const QString &fileName)
+{
+    return LogIndexReader::indexFileName(fileName);
+}
+
+quint32 crc32(const QByteArray &data)
+{
+    static const auto table = []() {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (const char ch : data)
+        crc = table[(crc ^ static_cast<quint8>(ch)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendLittleEndian(QByteArray &out, quint32 value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.append(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+// 把一块数据写成一个完整的 gzip 成员
+bool writeGzipMember(QFile &output, const QByteArray &data)
+{
+    QByteArray member("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+    if (data.isEmpty()) {
+        // 空输入的 deflate 流：一个空的固定哈夫曼末块
+        member.append("\x03\x00", 2);
+    } else {
+        // qCompress 输出为 4 字节长度 + zlib 流（2 字节头 + deflate + 4 字节 adler32），取出 deflate 部分
+        const QByteArray compressed = qCompress(data, 6);
+        if (compressed.size() < 10)
+            return false;
+        member.append(compressed.constData() + 6, compressed.size() - 10);
+    }
+    appendLittleEndian(member, crc32(data));
+    appendLittleEndian(member, static_cast<quint32>(data.size()));
+    return output.write(member) == member.size();
+}
+
+// 只识别滚动产生的备份名：<base>.N、<base>.<日期>、<base>.<日期>.N，均可带 .gz
+bool isBackupName(const QString &name, const QString &baseName, const QString &datePattern)
+{
+    if (name.size() <= baseName.size() + 1 || !name.startsWith(baseName) || name.at(baseName.size()) != QLatin1Char('.'))
+        return false;
+    QString rest = name.mid(baseName.size() + 1);
+    if (rest.endsWith(kGzipSuffix))
+        rest.chop(kGzipSuffix.size());
+
+    auto isNumber = [](const QString &text) {
+        bool ok = false;
+        text.toUInt(&ok);
+        return ok && !text.isEmpty() && text.at(0).isDigit();
+    };
+    if (isNumber(rest))
+        return true;
+    if (datePattern.isEmpty())
+        return false;
+    if (QDate::fromString(rest, datePattern).isValid())
+        return true;
+    const int dot = rest.lastIndexOf(QLatin1Char('.'));
+    return dot > 0 && isNumber(rest.mid(dot + 1)) && QDate::fromString(rest.left(dot), datePattern).isValid();
+}
+} // namespace
+
+AsyncRollingFileAppender::AsyncRollingFileAppender(QObject *parent)
+    : GroupCommitFileAppender(parent)
+    , m_maxFileSize(10 * 1024 * 1024)
+    , m_maxBackupIndex(1)
+    , m_compression(QStringLiteral("none"))
+    , m_maxTotalSize(0)
+    , m_keepDays(0)
+    , m_currentSize(0)
+    , m_periodStart(0)
+    , m_nextRollTime(0)
+    , m_rollSequence(0)
+    , m_resumed(false)
+{
+    m_rollPool.setMaxThreadCount(1);
+}
+
+AsyncRollingFileAppender::AsyncRollingFileAppender(const LayoutSharedPtr &layout,
+                                                   const QString         &fileName,
+                                                   QObject               *parent)
+    : AsyncRollingFileAppender(parent)
+{
+    setLayout(layout);
+    setFile(fileName);
+}
+
+AsyncRollingFileAppender::~AsyncRollingFileAppender()
+{
+    close();
+}
+
+void AsyncRollingFileAppender::setMaxFileSize(const QString &size)
+{
+    bool         ok;
+    const qint64 value = OptionConverter::toFileSize(size, &ok);
+    if (ok)
+        m_maxFileSize = value;
+}
+
+void AsyncRollingFileAppender::setMaxTotalSize(const QString &size)
+{
+    bool         ok;
+    const qint64 value = OptionConverter::toFileSize(size, &ok);
+    if (ok)
+        m_maxTotalSize = value;
+}
+
+void AsyncRollingFileAppender::activateOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+
+    checkCompression();
+
+    // 必须在打开文件之前：openFile() 不追加时会把旧日志改名为暂存文件并提交任务，之后再扫描会把它重复提交；
+    // 只在首次激活时扫描，之后的暂存文件都来自本对象，已有任务处理
+    if (!m_resumed) {
+        m_resumed = true;
+        resumePendingJobs();
+    }
+    GroupCommitFileAppender::activateOptions();
+}
+
+void AsyncRollingFileAppender::applyOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+
+    // 备份数量、大小与保留策略在下次滚动时读取，datePattern 变化需重新计算滚动时刻
+    checkCompression();
+    updateNextRollTime();
+    GroupCommitFileAppender::applyOptions();
+}
+
+void AsyncRollingFileAppender::checkCompression()
+{
+    if (m_compression != QLatin1String("none") && m_compression != QLatin1String("gzip")) {
+        logger()->warn(QStringLiteral("Unsupported compression '%1' for appender '%2', backups stay uncompressed"),
+                       m_compression,
+                       name());
+        m_compression = QStringLiteral("none");
+    }
+}
+
+void AsyncRollingFileAppender::close()
+{
+    {
+        QMutexLocker locker(&mObjectGuard);
+        GroupCommitFileAppender::close();
+    }
+    // 不持锁等待，后台任务不会访问 Appender
+    waitForRollOver();
+}
+
+void AsyncRollingFileAppender::waitForRollOver()
+{
+    m_rollPool.waitForDone();
+}
+
+void AsyncRollingFileAppender::append(const LoggingEvent &event)
+{
+    if (m_nextRollTime > 0 && event.timeStamp() >= m_nextRollTime)
+        rollOver();
+
+    indexEvent(event.timeStamp());
+
+    const QString message(layout()->format(event));
+    *writer() << message;
+    if (handleIoErrors())
+        return;
+
+    m_currentSize += message.size();
+    commit(message.size(), event.level());
+
+    if (m_maxFileSize > 0 && m_currentSize >= m_maxFileSize)
+        rollOver();
+}
+
+void AsyncRollingFileAppender::openFile()
+{
+    // 索引文件随日志一起改名，改名前先关闭
+    closeIndex();
+
+    // 与 RollingFileAppender 一致：不追加时先把旧文件滚走，避免重启时覆盖上次的日志
+    const QFileInfo info(file());
+    if (!appendFile() && info.exists() && info.size() > 0) {
+        handOff(info.filePath(),
+                m_datePattern.isEmpty() ? QString() : info.lastModified().date().toString(m_datePattern));
+    }
+
+    GroupCommitFileAppender::openFile();
+    m_currentSize = QFileInfo(file()).size();
+    updateNextRollTime();
+}
+
+void AsyncRollingFileAppender::rollOver()
+{
+    const QString dateSuffix = periodSuffix();
+
+    flushLocked(false);
+    closeFile();
+    closeIndex();
+    handOff(file(), dateSuffix);
+
+    // 改名失败时原文件仍在，以追加方式重新打开，避免截断未滚走的日志
+    const bool append = appendFile();
+    setAppendFile(true);
+    openFile();
+    setAppendFile(append);
+}
+
+void AsyncRollingFileAppender::handOff(const QString &fileName, const QString &dateSuffix)
+{
+    // 日志线程中只做这一次 rename，同一目录内为 O(1) 操作
+    const QString stagingName = QStringLiteral("%1.%2-%3%4")
+                                    .arg(fileName)
+                                    .arg(QDateTime::currentMSecsSinceEpoch())
+                                    .arg(++m_rollSequence)
+                                    .arg(kStagingSuffix);
+    QFile source(fileName);
+    if (!renameFile(source, stagingName))
+        return;
+    if (QFile::exists(idx(fileName)))
+        QFile::rename(idx(fileName), idx(stagingName));
+
+    const RollJob job{fileName,
+                      stagingName,
+                      dateSuffix,
+                      m_datePattern,
+                      m_maxBackupIndex,
+                      m_compression == QLatin1String("gzip"),
+                      m_maxTotalSize,
+                      m_keepDays};
+    QtConcurrent::run(&m_rollPool, [job]() { processRollJob(job); });
+}
+
+void AsyncRollingFileAppender::resumePendingJobs()
+{
+    // 进程在后台任务完成前退出时会留下暂存文件，启动后补做
+    const QFileInfo base(file());
+    const QDir      dir = base.absoluteDir();
+    const auto      leftovers = dir.entryInfoList({base.fileName() + QStringLiteral(".*") + kStagingSuffix},
+                                             QDir::Files,
+                                             QDir::Time | QDir::Reversed);
+    for (const QFileInfo &info : leftovers) {
+        const RollJob job{base.filePath(),
+                          info.filePath(),
+                          m_datePattern.isEmpty() ? QString() : info.lastModified().date().toString(m_datePattern),
+                          m_datePattern,
+                          m_maxBackupIndex,
+                          m_compression == QLatin1String("gzip"),
+                          m_maxTotalSize,
+                          m_keepDays};
+        QtConcurrent::run(&m_rollPool, [job]() { processRollJob(job); });
+    }
+}
+
+void AsyncRollingFileAppender::updateNextRollTime()
+{
+    if (m_datePattern.isEmpty()) {
+        m_nextRollTime = 0;
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    m_periodStart = now.toMSecsSinceEpoch();
+    m_nextRollTime = QDateTime(now.date().addDays(1), QTime(0, 0)).toMSecsSinceEpoch();
+}
+
+QString AsyncRollingFileAppender::periodSuffix() const
+{
+    if (m_datePattern.isEmpty())
+        return QString();
+    return QDateTime::fromMSecsSinceEpoch(m_periodStart).date().toString(m_datePattern);
+}
+
+void AsyncRollingFileAppender::processRollJob(const RollJob &job)
+{
+    const QString suffix = job.gzip ? kGzipSuffix : QString();
+    QString       target;
+
+    if (!job.dateSuffix.isEmpty()) {
+        // 同一周期内因大小多次滚动时依次追加序号
+        target = job.baseName + QLatin1Char('.') + job.dateSuffix;
+        for (int i = 1; QFile::exists(target) || QFile::exists(target + kGzipSuffix); ++i)
+            target = QStringLiteral("%1.%2.%3").arg(job.baseName, job.dateSuffix).arg(i);
+    } else {
+        if (job.maxBackupIndex <= 0) {
+            QFile::remove(job.stagingName);
+            QFile::remove(idx(job.stagingName));
+            return;
+        }
+        auto backup = [&job](int index) { return job.baseName + QLatin1Char('.') + QString::number(index); };
+        QFile::remove(backup(job.maxBackupIndex));
+        QFile::remove(backup(job.maxBackupIndex) + kGzipSuffix);
+        QFile::remove(idx(backup(job.maxBackupIndex)));
+        for (int i = job.maxBackupIndex - 1; i >= 1; --i) {
+            QFile::rename(backup(i), backup(i + 1));
+            QFile::rename(backup(i) + kGzipSuffix, backup(i + 1) + kGzipSuffix);
+            QFile::rename(idx(backup(i)), idx(backup(i + 1)));
+        }
+        target = backup(1);
+    }
+
+    // 索引中的偏移指向未压缩的文件，压缩后的备份不保留索引
+    if (job.gzip && gzipFile(job.stagingName, target + suffix)) {
+        QFile::remove(job.stagingName);
+        QFile::remove(idx(job.stagingName));
+    } else {
+        QFile::rename(job.stagingName, target);
+        QFile::rename(idx(job.stagingName), idx(target));
+    }
+
+    enforceRetention(job);
+}
+
+void AsyncRollingFileAppender::enforceRetention(const RollJob &job)
+{
+    if (job.maxTotalSize <= 0 && job.keepDays <= 0)
+        return;
+
+    const QFileInfo base(job.baseName);
+    const auto      backups = base.absoluteDir().entryInfoList({base.fileName() + QStringLiteral(".*")},
+                                                          QDir::Files,
+                                                          QDir::Time);
+    const QDateTime expire = QDateTime::currentDateTime().addDays(-job.keepDays);
+    qint64          total = 0;
+
+    // 按修改时间从新到旧累计，超出天数或总大小的旧备份删除；暂存文件、索引与同前缀的其他文件不计入
+    for (const QFileInfo &info : backups) {
+        if (!isBackupName(info.fileName(), base.fileName(), job.datePattern))
+            continue;
+        total += info.size();
+        if ((job.keepDays > 0 && info.lastModified() < expire)
+            || (job.maxTotalSize > 0 && total > job.maxTotalSize)) {
+            QFile::remove(info.filePath());
+            QFile::remove(idx(info.filePath()));
+        }
+    }
+}
+
+bool AsyncRollingFileAppender::gzipFile(const QString &source, const QString &target)
+{
+    QFile input(source);
+    if (!input.open(QIODevice::ReadOnly))
+        return false;
+    QFile output(target);
+    if (!output.open(QIODevice::WriteOnly))
+        return false;
+
+    // 按块读取压缩，每块一个 gzip 成员（RFC 1952 允许多个成员首尾相接），
+    // 同时只有一块数据及其压缩结果在内存中，超过 2GB 的备份也不受 QByteArray 大小限制
+    qint64 remaining = input.size();
+    do {
+        const QByteArray chunk = input.read(qMin<qint64>(remaining, kGzipChunkSize));
+        if (chunk.size() != qMin<qint64>(remaining, kGzipChunkSize) || !writeGzipMember(output, chunk)) {
+            output.remove();
+            return false;
+        }
+        remaining -= chunk.size();
+    } while (remaining > 0);
+    return true;
+}
+} // namespace Log
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include "groupcommitfileappender.h"
+
+#include <QThreadPool>
+
+/*
+* 后台滚动文件Appender：
+*   RollingFileAppender/DailyFileAppender 在 append() 内持锁完成整条 rename 链，
+*   滚动瞬间所有日志线程都会被阻塞。本类在日志线程中只做一次 rename 把当前文件
+*   改名为暂存文件并立即打开新文件，备份链重命名、压缩和保留策略全部交给后台线程
+*
+*   滚动条件：文件大小达到 maxFileSize；或设置了 datePattern 时跨天
+*   备份命名：未设置 datePattern 时为 app.log.1 ~ app.log.N（N = maxBackupIndex）
+*             设置 datePattern 时为 app.log.<日期>
+*   compression：none（默认）或 gzip，压缩后的备份追加 .gz 后缀（zstd 需额外依赖，暂不支持）
+*   gzip 按块压缩，每块写成一个 gzip 成员（gzip/zcat 按顺序解压拼接），内存占用与备份大小无关
+*   保留策略：maxTotalSize 限制备份总大小，keepDays 限制备份保留天数，0 表示不限制；
+*     只处理滚动产生的备份名（.N、.<日期>、.<日期>.N 及其 .gz），目录中同前缀的其他文件不受影响
+*   刷新策略和 indexInterval 时间索引继承自 GroupCommitFileAppender，索引文件随备份一起改名，压缩的备份不保留索引
+*
+*  log.conf 示例：
+*   log4j.appender.roll=Log::AsyncRollingFileAppender
+*   log4j.appender.roll.file=logs/app.log
+*   log4j.appender.roll.appendFile=true
+*   log4j.appender.roll.maxFileSize=50MB
+*   log4j.appender.roll.maxBackupIndex=20
+*   log4j.appender.roll.compression=gzip
+*   log4j.appender.roll.maxTotalSize=1GB
+*   log4j.appender.roll.keepDays=30
+*/
+
+namespace Log {
+class AsyncRollingFileAppender : public GroupCommitFileAppender
+{
+    Q_OBJECT
+    Q_CLASSINFO("LiveOptions", "maxFileSize,maxBackupIndex,datePattern,compression,maxTotalSize,keepDays")
+
+    Q_PROPERTY(QString maxFileSize READ maxFileSize WRITE setMaxFileSize)
+    Q_PROPERTY(int maxBackupIndex READ maxBackupIndex WRITE setMaxBackupIndex)
+    Q_PROPERTY(QString datePattern READ datePattern WRITE setDatePattern)
+    Q_PROPERTY(QString compression READ compression WRITE setCompression)
+    Q_PROPERTY(QString maxTotalSize READ maxTotalSize WRITE setMaxTotalSize)
+    Q_PROPERTY(int keepDays READ keepDays WRITE setKeepDays)
+
+public:
+    explicit AsyncRollingFileAppender(QObject *parent = nullptr);
+    AsyncRollingFileAppender(const Log4Qt::LayoutSharedPtr &layout,
+                             const QString                 &fileName,
+                             QObject                       *parent = nullptr);
+    ~AsyncRollingFileAppender() override;
+
+    QString maxFileSize() const { return QString::number(m_maxFileSize); }
+    int     maxBackupIndex() const { return m_maxBackupIndex; }
+    QString datePattern() const { return m_datePattern; }
+    QString compression() const { return m_compression; }
+    QString maxTotalSize() const { return QString::number(m_maxTotalSize); }
+    int     keepDays() const { return m_keepDays; }
+
+    void setMaxFileSize(const QString &size);
+    void setMaxBackupIndex(int count) { m_maxBackupIndex = count; }
+    void setDatePattern(const QString &pattern) { m_datePattern = pattern; }
+    void setCompression(const QString &compression) { m_compression = compression.trimmed().toLower(); }
+    void setMaxTotalSize(const QString &size);
+    void setKeepDays(int days) { m_keepDays = days; }
+
+    void activateOptions() override;
+    void close() override;
+    void applyOptions() override;
+
+    // 等待已提交的后台滚动任务全部完成
+    void waitForRollOver();
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+    void openFile() override;
+
+private:
+    // 后台线程处理一个已关闭文件所需的全部参数，避免工作线程访问 Appender 成员
+    struct RollJob
+    {
+        QString baseName;
+        QString stagingName;
+        QString dateSuffix;
+        QString datePattern; // 保留策略据此识别带日期的备份名
+        int     maxBackupIndex;
+        bool    gzip;
+        qint64  maxTotalSize;
+        int     keepDays;
+    };
+
+    void        checkCompression();
+    void        rollOver();
+    void        handOff(const QString &fileName, const QString &dateSuffix);
+    void        resumePendingJobs();
+    void        updateNextRollTime();
+    QString     periodSuffix() const;
+    static void processRollJob(const RollJob &job);
+    static void enforceRetention(const RollJob &job);
+    static bool gzipFile(const QString &source, const QString &target);
+
+    qint64  m_maxFileSize;
+    int     m_maxBackupIndex;
+    QString m_datePattern;
+    QString m_compression;
+    qint64  m_maxTotalSize;
+    int     m_keepDays;
+
+    qint64  m_currentSize;
+    qint64  m_periodStart;
+    qint64  m_nextRollTime;
+    quint32 m_rollSequence;
+    bool    m_resumed; // 已补做上次进程遗留的暂存文件
+
+    // 单线程池，保证滚动任务按提交顺序串行执行
+    QThreadPool m_rollPool;
+};
+} // namespace Log
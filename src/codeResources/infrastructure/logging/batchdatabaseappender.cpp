@@ -0,0 +1,256 @@
+﻿#include "batchdatabaseappender.h"
+#include "log4qt/databaselayout.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDeadlineTimer>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+bool sameColumns(const QSqlRecord &record, const QStringList &columns)
+{
+    if (record.count() != columns.size())
+        return false;
+    for (int field = 0; field < record.count(); ++field) {
+        if (record.fieldName(field) != columns.at(field))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+BatchDatabaseAppender::BatchDatabaseAppender(QObject *parent)
+    : DatabaseAppender(parent)
+    , m_batchSize(500)
+    , m_flushInterval(1000)
+    , m_maxPending(10000)
+    , m_enqueued(0)
+    , m_committed(0)
+    , m_flushRequests(0)
+    , m_running(false)
+    , m_stopping(false)
+    , m_worker(nullptr)
+{
+}
+
+BatchDatabaseAppender::BatchDatabaseAppender(const LayoutSharedPtr &layout,
+                                             const QString         &tableName,
+                                             const QString         &connection,
+                                             QObject               *parent)
+    : BatchDatabaseAppender(parent)
+{
+    setLayout(layout);
+    setTable(tableName);
+    setConnection(connection);
+}
+
+BatchDatabaseAppender::~BatchDatabaseAppender()
+{
+    close();
+}
+
+void BatchDatabaseAppender::activateOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+
+    // 重新激活时先写完旧队列，表名与连接的修改随新线程生效
+    stopWorker();
+    if (!qobject_cast<DatabaseLayout *>(layout().data())) {
+        logger()->error(QStringLiteral("Appender '%1' requires a DatabaseLayout"), name());
+        return;
+    }
+    DatabaseAppender::activateOptions();
+    if (isActive())
+        startWorker();
+}
+
+void BatchDatabaseAppender::close()
+{
+    QMutexLocker locker(&mObjectGuard);
+    if (isClosed())
+        return;
+    stopWorker();
+    DatabaseAppender::close();
+}
+
+void BatchDatabaseAppender::flush()
+{
+    QMutexLocker locker(&m_queueLock);
+    const quint64 target = m_enqueued;
+    ++m_flushRequests;
+    m_wake.wakeOne();
+    while (m_running && m_committed < target)
+        m_drained.wait(&m_queueLock);
+    --m_flushRequests;
+}
+
+void BatchDatabaseAppender::append(const LoggingEvent &event)
+{
+    // checkEntryConditions 已确认布局类型
+    const QSqlRecord record = static_cast<DatabaseLayout *>(layout().data())->formatRecord(event);
+
+    QString error;
+    {
+        QMutexLocker locker(&m_queueLock);
+        while (m_running && int(m_pending.size()) >= m_maxPending)
+            m_space.wait(&m_queueLock);
+        if (m_pending.empty()) {
+            m_oldestPending.start();
+            m_wake.wakeOne();
+        }
+        m_pending.push_back(record);
+        ++m_enqueued;
+        if (int(m_pending.size()) == m_batchSize)
+            m_wake.wakeOne();
+        error.swap(m_error);
+    }
+
+    // 后台线程不能直接记录日志：它可能正好要写入本 Appender，而日志线程此时可能在等待队列空间
+    if (!error.isEmpty())
+        logger()->error(QStringLiteral("Batch insert into '%1' failed: %2"), table(), error);
+}
+
+bool BatchDatabaseAppender::checkEntryConditions() const
+{
+    if (!m_worker)
+        return false;
+    return AppenderSkeleton::checkEntryConditions();
+}
+
+void BatchDatabaseAppender::startWorker()
+{
+    {
+        QMutexLocker locker(&m_queueLock);
+        m_running = true;
+        m_stopping = false;
+    }
+    const QString connection = this->connection();
+    const QString table = this->table();
+    m_worker = QThread::create([this, connection, table]() { run(connection, table); });
+    m_worker->setObjectName(QStringLiteral("BatchDatabaseAppender"));
+    m_worker->start();
+}
+
+void BatchDatabaseAppender::stopWorker()
+{
+    if (!m_worker)
+        return;
+    {
+        QMutexLocker locker(&m_queueLock);
+        m_stopping = true;
+        m_wake.wakeOne();
+    }
+    m_worker->wait();
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void BatchDatabaseAppender::run(const QString &connection, const QString &table)
+{
+    const QString name = QStringLiteral("%1.batch.%2").arg(connection).arg(quintptr(this), 0, 16);
+    {
+        // 连接不能跨线程使用，在后台线程中复制一份
+        QSqlDatabase database = QSqlDatabase::cloneDatabase(connection, name);
+        if (database.open() && database.driverName().startsWith(QLatin1String("QSQLITE"))) {
+            // WAL 下提交只追加日志文件，读者不阻塞写入
+            QSqlQuery pragma(database);
+            pragma.exec(QStringLiteral("PRAGMA journal_mode=WAL"));
+            pragma.exec(QStringLiteral("PRAGMA synchronous=NORMAL"));
+        }
+
+        QSqlQuery               insert(database);
+        QStringList             columns;
+        std::vector<QSqlRecord> records;
+
+        QMutexLocker locker(&m_queueLock);
+        for (;;) {
+            while (!m_stopping && m_flushRequests == 0 && int(m_pending.size()) < m_batchSize) {
+                if (m_pending.empty()) {
+                    m_wake.wait(&m_queueLock);
+                    continue;
+                }
+                if (m_flushInterval <= 0)
+                    break;
+                const qint64 remaining = m_flushInterval - m_oldestPending.elapsed();
+                if (remaining <= 0 || !m_wake.wait(&m_queueLock, QDeadlineTimer(remaining)))
+                    break;
+            }
+            if (m_pending.empty()) {
+                m_drained.wakeAll();
+                if (m_stopping)
+                    break;
+                // 没有可写的记录时等待下一次唤醒，避免响应 flush 时空转
+                m_wake.wait(&m_queueLock);
+                continue;
+            }
+
+            records.swap(m_pending);
+            m_space.wakeAll();
+            locker.unlock();
+
+            const QString error = write(database, insert, columns, table, records);
+            const quint64 written = records.size();
+            records.clear();
+
+            locker.relock();
+            m_committed += written;
+            if (!error.isEmpty())
+                m_error = error;
+            m_drained.wakeAll();
+        }
+        m_running = false;
+        m_drained.wakeAll();
+        m_space.wakeAll();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+QString BatchDatabaseAppender::write(QSqlDatabase                  &database,
+                                     QSqlQuery                     &insert,
+                                     QStringList                   &columns,
+                                     const QString                 &table,
+                                     const std::vector<QSqlRecord> &records) const
+{
+    if (!database.isOpen())
+        return database.lastError().text();
+
+    QString error;
+    for (size_t begin = 0; begin < records.size(); begin += size_t(m_batchSize)) {
+        const size_t end = qMin(records.size(), begin + size_t(m_batchSize));
+        database.transaction();
+        for (size_t i = begin; i < end; ++i) {
+            const QSqlRecord &record = records[i];
+
+            // 布局的列配置不变时语句只预编译一次
+            if (!sameColumns(record, columns)) {
+                const QString statement =
+                    database.driver()->sqlStatement(QSqlDriver::InsertStatement, table, record, true);
+                columns.clear();
+                if (!insert.prepare(statement)) {
+                    error = insert.lastError().text();
+                    continue;
+                }
+                for (int field = 0; field < record.count(); ++field)
+                    columns.append(record.fieldName(field));
+            }
+
+            for (int field = 0; field < record.count(); ++field)
+                insert.bindValue(field, record.value(field));
+            if (!insert.exec())
+                error = insert.lastError().text();
+        }
+        if (!database.commit()) {
+            error = database.lastError().text();
+            database.rollback();
+        }
+    }
+    return error;
+}
+} // namespace Log
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include "log4qt/databaseappender.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSqlRecord>
+#include <QWaitCondition>
+
+#include <vector>
+
+class QSqlDatabase;
+class QSqlQuery;
+class QThread;
+
+/*
+* 批量事务数据库Appender：
+*   DatabaseAppender 每个事件执行一次 INSERT，SQLite 下相当于每行一个隐式事务，每秒只能写几百行；
+*   本类在日志线程中只用 DatabaseLayout 生成记录并放入队列，由后台线程批量写入：
+*     攒够 batchSize 行或最早的记录等待超过 flushInterval 毫秒时，在一个事务中写入
+*   后台线程使用 cloneDatabase 复制的独立连接，INSERT 语句只预编译一次
+*   SQLite 连接打开后设置 journal_mode=WAL、synchronous=NORMAL
+*   队列达到 maxPending 行时日志线程等待写入，不丢弃记录；写入失败在下一次记录日志时报告
+*
+*   connection 指定的连接需要在 activateOptions 之前添加，并且在 close 之前保持存在
+*
+*   依赖 QtSql，默认不注册：编译本文件、链接 Qt::Sql 并定义 QTRAPIDCORE_LOG_SQL 后 log.conf 才能引用，
+*   例如 CMake 中 target_compile_definitions(app PRIVATE QTRAPIDCORE_LOG_SQL)
+*
+*  log.conf 示例：
+*   log4j.appender.db=Log::BatchDatabaseAppender
+*   log4j.appender.db.connection=logdb
+*   log4j.appender.db.table=log
+*   log4j.appender.db.batchSize=500
+*   log4j.appender.db.flushInterval=1000
+*   log4j.appender.db.maxPending=10000
+*   log4j.appender.db.layout=Log4Qt::DatabaseLayout
+*   log4j.appender.db.layout.timeStampColumn=time
+*   log4j.appender.db.layout.levelColumn=level
+*   log4j.appender.db.layout.loggenameColumn=logger
+*   log4j.appender.db.layout.messageColumn=message
+*/
+
+namespace Log {
+class BatchDatabaseAppender : public Log4Qt::DatabaseAppender
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int batchSize READ batchSize WRITE setBatchSize)
+    Q_PROPERTY(int flushInterval READ flushInterval WRITE setFlushInterval)
+    Q_PROPERTY(int maxPending READ maxPending WRITE setMaxPending)
+
+public:
+    explicit BatchDatabaseAppender(QObject *parent = nullptr);
+    BatchDatabaseAppender(const Log4Qt::LayoutSharedPtr &layout,
+                          const QString                 &tableName,
+                          const QString                 &connection,
+                          QObject                       *parent = nullptr);
+    ~BatchDatabaseAppender() override;
+
+    int batchSize() const { return m_batchSize; }
+    int flushInterval() const { return m_flushInterval; }
+    int maxPending() const { return m_maxPending; }
+
+    void setBatchSize(int rows) { m_batchSize = qMax(1, rows); }
+    void setFlushInterval(int msecs) { m_flushInterval = msecs; }
+    void setMaxPending(int rows) { m_maxPending = qMax(1, rows); }
+
+    void activateOptions() override;
+    void close() override;
+
+    // 等待调用前进入队列的记录全部提交
+    void flush();
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+
+    // 连接只能在创建它的线程中使用，这里不再检查调用线程上的连接，改为检查后台线程是否运行
+    bool checkEntryConditions() const override;
+
+private:
+    void    startWorker();
+    void    stopWorker();
+    void    run(const QString &connection, const QString &table);
+    QString write(QSqlDatabase                  &database,
+                  QSqlQuery                     &insert,
+                  QStringList                   &columns,
+                  const QString                 &table,
+                  const std::vector<QSqlRecord> &records) const;
+
+    int m_batchSize;
+    int m_flushInterval;
+    int m_maxPending;
+
+    // 以下成员由 m_queueLock 保护
+    QMutex                  m_queueLock;
+    QWaitCondition          m_wake;    // 唤醒后台线程
+    QWaitCondition          m_space;   // 队列腾出空间
+    QWaitCondition          m_drained; // 一批记录提交完成
+    std::vector<QSqlRecord> m_pending;
+    QElapsedTimer           m_oldestPending;
+    quint64                 m_enqueued;
+    quint64                 m_committed;
+    int                     m_flushRequests;
+    bool                    m_running;
+    bool                    m_stopping;
+    QString                 m_error;
+
+    QThread *m_worker;
+};
+} // namespace Log
@@ -0,0 +1,107 @@
+﻿#include "batchsignalappender.h"
+#include "logmetrics.h"
+#include "log4qt/layout.h"
+#include "log4qt/level.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDateTime>
+#include <QThread>
+#include <QTimer>
+
+namespace Log {
+using namespace Log4Qt;
+
+BatchSignalAppender::BatchSignalAppender(QObject *parent)
+    : AppenderSkeleton(false, parent)
+    , m_interval(16)
+    , m_maxPending(10000)
+    , m_dropped(0)
+    , m_scheduled(false)
+    , m_timer(new QTimer(this))
+{
+    qRegisterMetaType<QVector<Log::LogRecord>>();
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &BatchSignalAppender::flush);
+}
+
+BatchSignalAppender::~BatchSignalAppender()
+{
+    close();
+}
+
+void BatchSignalAppender::close()
+{
+    {
+        QMutexLocker locker(&mObjectGuard);
+        if (isClosed())
+            return;
+        AppenderSkeleton::close();
+    }
+    // 关闭前收到的事件照常发出
+    if (thread() == QThread::currentThread())
+        flush();
+}
+
+void BatchSignalAppender::append(const LoggingEvent &event)
+{
+    LogRecord record;
+    record.timeStamp = event.timeStamp();
+    record.level = event.level().toInt();
+    record.logger = event.loggename();
+    record.thread = event.threadName();
+    record.message = layout() ? layout()->format(event) : event.message();
+
+    bool wake = false;
+    bool dropped = false;
+    {
+        QMutexLocker locker(&m_lock);
+        if (int(m_pending.size()) >= qMax(1, m_maxPending)) {
+            m_pending.pop_front();
+            ++m_dropped;
+            dropped = true;
+        }
+        m_pending.push_back(std::move(record));
+        wake = !m_scheduled;
+        m_scheduled = true;
+    }
+    if (dropped)
+        LogMetrics::add(LogMetrics::Dropped, name());
+    // 一个发送周期内只有第一条事件投递调度请求
+    if (wake)
+        QMetaObject::invokeMethod(this, [this]() { schedule(); }, Qt::QueuedConnection);
+}
+
+void BatchSignalAppender::schedule()
+{
+    if (m_interval <= 0)
+        flush();
+    else if (!m_timer->isActive())
+        m_timer->start(m_interval);
+}
+
+void BatchSignalAppender::flush()
+{
+    QVector<LogRecord> records;
+    {
+        QMutexLocker locker(&m_lock);
+        m_scheduled = false;
+        if (m_pending.empty() && m_dropped == 0)
+            return;
+
+        records.reserve(int(m_pending.size()) + 1);
+        if (m_dropped > 0) {
+            LogRecord marker;
+            marker.timeStamp = QDateTime::currentMSecsSinceEpoch();
+            marker.level = Level::WARN_INT;
+            marker.logger = name();
+            marker.message = QStringLiteral("dropped %1 events").arg(m_dropped);
+            records.append(std::move(marker));
+            m_dropped = 0;
+        }
+        for (LogRecord &record : m_pending)
+            records.append(std::move(record));
+        m_pending.clear();
+    }
+    emit appended(records);
+}
+} // namespace Log
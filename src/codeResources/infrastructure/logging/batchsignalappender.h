@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include "ringbufferappender.h"
+#include "log4qt/appenderskeleton.h"
+
+#include <QMutex>
+#include <QVector>
+
+#include <deque>
+
+class QTimer;
+
+/*
+* 批量信号Appender（替代 SignalAppender）：
+*   SignalAppender 每条事件发出一次信号，接收者在其他线程时每条日志都是一次排队的跨线程调用，
+*   日志突发时事件循环被淹没。本类在日志线程中只把事件放入待发队列，
+*   所属线程（通常是 GUI 线程）每 interval 毫秒（默认 16，约一帧）发出一次 appended，携带这段时间内的全部事件
+*   每个发送周期最多只投递一次跨线程调用；待发事件超过 maxPending 时丢弃最旧的事件，
+*   下一批开头插入一条 WARN 级别的 "dropped N events" 记录
+*   设置了 layout 时 LogRecord::message 为格式化后的整行，否则为原始消息
+*   所属线程必须运行事件循环
+*
+*  log.conf 示例：
+*   log4j.appender.pane=Log::BatchSignalAppender
+*   log4j.appender.pane.interval=16
+*   log4j.appender.pane.maxPending=10000
+*
+*  Example:
+*   connect(appender, &Log::BatchSignalAppender::appended, view, &LogView::appendRecords);
+*/
+
+namespace Log {
+class BatchSignalAppender : public Log4Qt::AppenderSkeleton
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int interval READ interval WRITE setInterval)
+    Q_PROPERTY(int maxPending READ maxPending WRITE setMaxPending)
+
+public:
+    explicit BatchSignalAppender(QObject *parent = nullptr);
+    ~BatchSignalAppender() override;
+
+    int  interval() const { return m_interval; }
+    int  maxPending() const { return m_maxPending; }
+    void setInterval(int interval) { m_interval = interval; }
+    void setMaxPending(int count) { m_maxPending = count; }
+
+    bool requiresLayout() const override { return false; }
+    void close() override;
+
+    // 立即发出待发事件，只能在所属线程调用
+    void flush();
+
+Q_SIGNALS:
+    void appended(const QVector<Log::LogRecord> &records);
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+
+private:
+    void schedule();
+
+    int m_interval;
+    int m_maxPending;
+
+    // 以下由 m_lock 保护，发送时不持有 mObjectGuard，不会等待正在格式化的日志线程
+    QMutex                m_lock;
+    std::deque<LogRecord> m_pending;
+    quint64               m_dropped;
+    bool                  m_scheduled; // 已投递调度请求，尚未发送
+
+    QTimer *m_timer;
+};
+} // namespace Log
@@ -0,0 +1,113 @@
+﻿#include "fastlogstream.h"
+#include "logmetrics.h"
+#include "pooledevent.h"
+#include "samplingfilter.h"
+#include "log4qt/loggingevent.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace Log {
+using namespace Log4Qt;
+
+FastLogStream::FastLogStream(Logger *logger, Level level, const char *file, int line, const char *function)
+    : m_logger(logger)
+    , m_level(level)
+    , m_file(file)
+    , m_line(line)
+    , m_function(function)
+    , m_active(SamplingFilter::preSample(logger, level, &m_mark) != SamplingFilter::Discard)
+{
+    if (!m_active)
+        LogMetrics::countFiltered(logger);
+}
+
+FastLogStream::~FastLogStream()
+{
+    if (!m_active)
+        return;
+
+    PooledEvent event;
+    event.message().append(m_buffer.constData(), int(m_buffer.size()));
+    if (!m_mark.isEmpty())
+        event.setProperty(SamplingFilter::markProperty(), m_mark);
+    event.dispatch(m_logger, m_level, MessageContext(m_file, m_line, m_function));
+}
+
+FastLogStream &FastLogStream::operator<<(const char *value)
+{
+    return value ? appendUtf8(value, int(std::strlen(value))) : *this;
+}
+
+FastLogStream &FastLogStream::operator<<(const void *value)
+{
+    if (!m_active)
+        return *this;
+    char       buffer[2 + 2 * sizeof(quintptr)] = {'0', 'x'};
+    const auto result = std::to_chars(buffer + 2, buffer + sizeof(buffer), quintptr(value), 16);
+    return appendLatin1(buffer, int(result.ptr - buffer));
+}
+
+FastLogStream &FastLogStream::operator<<(double value)
+{
+    if (!m_active)
+        return *this;
+#ifdef __cpp_lib_to_chars
+    // 与 QTextStream 默认的 SmartNotation、精度 6 一致，即 %g
+    char       buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    return appendLatin1(buffer, int(result.ptr - buffer));
+#else
+    // 标准库尚未提供浮点数 to_chars 时退回 QString::number
+    return *this << QString::number(value, 'g', 6);
+#endif
+}
+
+FastLogStream &FastLogStream::append(const QChar *data, int size)
+{
+    if (m_active)
+        m_buffer.append(data, size);
+    return *this;
+}
+
+FastLogStream &FastLogStream::appendLatin1(const char *data, int size)
+{
+    if (!m_active)
+        return *this;
+    const int offset = int(m_buffer.size());
+    m_buffer.resize(offset + size);
+    QChar *out = m_buffer.data() + offset;
+    for (int i = 0; i < size; ++i)
+        out[i] = QLatin1Char(data[i]);
+    return *this;
+}
+
+FastLogStream &FastLogStream::appendUtf8(const char *data, int size)
+{
+    if (!m_active)
+        return *this;
+    for (int i = 0; i < size; ++i) {
+        if (static_cast<uchar>(data[i]) >= 0x80)
+            return *this << QString::fromUtf8(data, size);
+    }
+    return appendLatin1(data, size);
+}
+
+FastLogStream &FastLogStream::appendInteger(qint64 value)
+{
+    if (!m_active)
+        return *this;
+    char       buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return appendLatin1(buffer, int(result.ptr - buffer));
+}
+
+FastLogStream &FastLogStream::appendUnsigned(quint64 value)
+{
+    if (!m_active)
+        return *this;
+    char       buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return appendLatin1(buffer, int(result.ptr - buffer));
+}
+} // namespace Log
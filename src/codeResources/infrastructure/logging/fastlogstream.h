@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include "logcategory.h"
+#include "log4qt/level.h"
+
+#include <QByteArray>
+#include <QLatin1String>
+#include <QString>
+#include <QVarLengthArray>
+
+#include <type_traits>
+
+namespace Log4Qt {
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 流式日志（替代 Logger::debug() 等返回的 LogStream）：
+*   LogStream 每条日志分配共享的 Stream 对象，经 QTextStream 写入不断扩容的 QString；
+*   本类在栈上的内联缓冲区（256 个 QChar，即 512 字节）中拼接消息，超出时才转到堆上，
+*   整数、浮点数用 std::to_chars 转换，UTF-8 字符串中的 ASCII 部分直接展开，结束时交给 PooledEvent 输出
+*   数值输出与 QTextStream 默认格式一致：bool 输出 1/0，浮点数按 %g 保留 6 位有效数字，指针为 0x 开头的十六进制
+*
+*   LOGS 等宏在级别未开启时整条语句不执行，operator<< 右侧的参数不会被求值；
+*   Debug 版本同时记录调用位置（%F %L %M 可以输出），不像 LOGD 那样拼接到消息末尾
+*
+*  Example:
+*   LOGSD(lcNetwork) << "connect to " << host << ':' << port;
+*   LOGSW(lcNetwork) << "retry " << attempt << " after " << delay.count() << " ms";
+*/
+
+#ifdef QT_NO_DEBUG
+#define LOGS(category, level) \
+    for (bool LOG_CONCAT(log_stream_enabled_, __LINE__) = category().isEnabled(Log4Qt::Level::level); \
+         LOG_CONCAT(log_stream_enabled_, __LINE__); \
+         LOG_CONCAT(log_stream_enabled_, __LINE__) = false) \
+    Log::FastLogStream(category().logger(), Log4Qt::Level::level)
+#else
+#define LOGS(category, level) \
+    for (bool LOG_CONCAT(log_stream_enabled_, __LINE__) = category().isEnabled(Log4Qt::Level::level); \
+         LOG_CONCAT(log_stream_enabled_, __LINE__); \
+         LOG_CONCAT(log_stream_enabled_, __LINE__) = false) \
+    Log::FastLogStream(category().logger(), Log4Qt::Level::level, __FILE__, __LINE__, Q_FUNC_INFO)
+#endif
+
+#define LOGST(category) LOGS(category, TRACE_INT)
+#define LOGSD(category) LOGS(category, DEBUG_INT)
+#define LOGSI(category) LOGS(category, INFO_INT)
+#define LOGSW(category) LOGS(category, WARN_INT)
+#define LOGSE(category) LOGS(category, ERROR_INT)
+#define LOGSF(category) LOGS(category, FATAL_INT)
+
+namespace Log {
+class FastLogStream
+{
+public:
+    // 级别由调用方（LOGS 等宏）判定，构造时只做采样判定；file、function 须为静态存储期的字符串
+    FastLogStream(Log4Qt::Logger *logger,
+                  Log4Qt::Level   level,
+                  const char     *file = nullptr,
+                  int             line = -1,
+                  const char     *function = nullptr);
+    ~FastLogStream();
+
+    FastLogStream &operator<<(const QString &value) { return append(value.constData(), value.size()); }
+    FastLogStream &operator<<(QLatin1String value) { return appendLatin1(value.data(), value.size()); }
+    FastLogStream &operator<<(const char *value);
+    FastLogStream &operator<<(const QByteArray &value) { return appendUtf8(value.constData(), value.size()); }
+    FastLogStream &operator<<(QChar value) { return append(&value, 1); }
+    FastLogStream &operator<<(char value) { return appendLatin1(&value, 1); }
+    FastLogStream &operator<<(bool value) { return appendInteger(value ? 1 : 0); }
+    FastLogStream &operator<<(const void *value);
+    FastLogStream &operator<<(double value);
+    FastLogStream &operator<<(float value) { return *this << double(value); }
+
+    template<typename T>
+    FastLogStream &operator<<(const T &value)
+    {
+        if constexpr (std::is_same_v<T, char *>)
+            return *this << static_cast<const char *>(value);
+        else if constexpr (std::is_pointer_v<T>)
+            return *this << static_cast<const void *>(value);
+        else if constexpr (std::is_enum_v<T>)
+            return appendInteger(qint64(value));
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            return appendInteger(qint64(value));
+        else if constexpr (std::is_integral_v<T>)
+            return appendUnsigned(quint64(value));
+        else if constexpr (std::is_floating_point_v<T>)
+            return *this << double(value);
+        else
+            return *this << QString(value);
+    }
+
+private:
+    Q_DISABLE_COPY(FastLogStream)
+
+    static constexpr int kInlineSize = 256;
+
+    FastLogStream &append(const QChar *data, int size);
+    FastLogStream &appendLatin1(const char *data, int size);
+    FastLogStream &appendUtf8(const char *data, int size);
+    FastLogStream &appendInteger(qint64 value);
+    FastLogStream &appendUnsigned(quint64 value);
+
+    Log4Qt::Logger *m_logger;
+    Log4Qt::Level   m_level;
+    const char     *m_file;
+    int             m_line;
+    const char     *m_function;
+    QString         m_mark; // SamplingFilter 的采样标记，须在 m_active 之前初始化
+    bool            m_active;
+
+    QVarLengthArray<QChar, kInlineSize> m_buffer;
+};
+} // namespace Log
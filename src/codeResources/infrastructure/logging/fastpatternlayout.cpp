@@ -0,0 +1,386 @@
+﻿#include "fastpatternlayout.h"
+#include "log4qt/helpers/patternformatter.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDateTime>
+
+#include <charconv>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+// Converter::millisOffset 的特殊取值
+constexpr int kNoMillis = -1;    // 同一秒内输出不变
+constexpr int kExactMillis = -2; // 无法定位毫秒，按毫秒缓存
+
+const QString kSpaces(64, QLatin1Char(' '));
+
+void appendNumber(QString &out, qint64 value)
+{
+    char       buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(QLatin1String(buffer, int(result.ptr - buffer)));
+}
+
+void appendPadding(QString &out, int position, int count)
+{
+    while (count > 0) {
+        const int chunk = qMin(count, kSpaces.size());
+        out.insert(position, kSpaces.constData(), chunk);
+        count -= chunk;
+    }
+}
+
+qint64 floorSecond(qint64 msecs)
+{
+    return msecs >= 0 ? msecs / 1000 : -((-msecs + 999) / 1000);
+}
+
+// 自检用的探测事件，覆盖有/无调用位置、MDC、NDC 以及不同长度的级别名和消息
+std::vector<LoggingEvent> probeEvents(const Logger *logger)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QString longText(120, QLatin1Char('x'));
+
+    std::vector<LoggingEvent> events;
+    events.emplace_back(logger,
+                        Level(Level::INFO_INT),
+                        QStringLiteral("probe message"),
+                        QStringLiteral("ndc"),
+                        QHash<QString, QString>{{QStringLiteral("requestId"), QStringLiteral("42")}},
+                        QStringLiteral("worker-1"),
+                        now,
+                        MessageContext("probe.cpp", 123, "void probe()"),
+                        QString());
+    events.emplace_back(logger,
+                        Level(Level::ERROR_INT),
+                        longText,
+                        QString(),
+                        QHash<QString, QString>(),
+                        QString(),
+                        now + 1234,
+                        MessageContext(),
+                        QString());
+    events.emplace_back(logger,
+                        Level(Level::DEBUG_INT),
+                        QString(),
+                        longText,
+                        QHash<QString, QString>{{QStringLiteral("requestId"), longText}},
+                        longText,
+                        now + 59999,
+                        MessageContext("", 0, ""),
+                        QString());
+    events.emplace_back(logger, Level(Level::WARN_INT), QStringLiteral("plain"));
+    return events;
+}
+} // namespace
+
+FastPatternLayout::FastPatternLayout(QObject *parent)
+    : Layout(parent)
+    , m_probeLogger(Logger::logger(QStringLiteral("Log::FastPatternLayout")))
+    , m_downgraded(0)
+{
+    setConversionPattern(QStringLiteral("%m%n"));
+}
+
+FastPatternLayout::FastPatternLayout(const QString &pattern, QObject *parent)
+    : Layout(parent)
+    , m_probeLogger(Logger::logger(QStringLiteral("Log::FastPatternLayout")))
+    , m_downgraded(0)
+{
+    setConversionPattern(pattern);
+}
+
+FastPatternLayout::~FastPatternLayout() = default;
+
+void FastPatternLayout::setConversionPattern(const QString &pattern)
+{
+    QMutexLocker locker(&m_lock);
+    m_pattern = pattern;
+    compile();
+}
+
+QString FastPatternLayout::format(const LoggingEvent &event)
+{
+    QMutexLocker locker(&m_lock);
+    if (m_fallback)
+        return m_fallback->format(event);
+
+    // 上一条结果已被调用方释放时复用其容量
+    if (!m_buffer.isDetached())
+        m_buffer = QString();
+    m_buffer.resize(0);
+    formatCompiled(m_buffer, event);
+    return m_buffer;
+}
+
+void FastPatternLayout::compile()
+{
+    m_converters.clear();
+    m_fallback.reset();
+    m_downgraded = 0;
+    if (!parse()) {
+        m_fallback.reset(new PatternFormatter(m_pattern));
+        return;
+    }
+    verify();
+}
+
+bool FastPatternLayout::parse()
+{
+    const QString &p = m_pattern;
+    const int      size = p.size();
+    QString        literal;
+
+    auto flushLiteral = [this, &literal]() {
+        if (literal.isEmpty())
+            return;
+        Converter converter;
+        converter.text = literal;
+        m_converters.push_back(std::move(converter));
+        literal.clear();
+    };
+    auto readNumber = [&p, size](int &i, int &value) {
+        const int start = i;
+        value = 0;
+        while (i < size && p.at(i).isDigit())
+            value = qMin(value * 10 + p.at(i++).digitValue(), INT_MAX / 10);
+        return i > start;
+    };
+
+    int i = 0;
+    while (i < size) {
+        if (p.at(i) != QLatin1Char('%')) {
+            literal.append(p.at(i++));
+            continue;
+        }
+        if (i + 1 >= size)
+            return false;
+        if (p.at(i + 1) == QLatin1Char('%')) {
+            literal.append(QLatin1Char('%'));
+            i += 2;
+            continue;
+        }
+
+        flushLiteral();
+        const int start = i++;
+        Converter converter;
+        if (p.at(i) == QLatin1Char('-')) {
+            converter.leftAlign = true;
+            ++i;
+        }
+        int value;
+        if (readNumber(i, value))
+            converter.minWidth = value;
+        if (i < size && p.at(i) == QLatin1Char('.')) {
+            ++i;
+            if (!readNumber(i, value))
+                return false;
+            converter.maxWidth = value;
+        }
+        if (i >= size)
+            return false;
+
+        const QChar conversion = p.at(i++);
+        QString     option;
+        if (i < size && p.at(i) == QLatin1Char('{')) {
+            const int close = p.indexOf(QLatin1Char('}'), i);
+            if (close < 0)
+                return false;
+            option = p.mid(i + 1, close - i - 1);
+            i = close + 1;
+        }
+
+        switch (conversion.unicode()) {
+        case 'm': converter.kind = Converter::Message; break;
+        case 'p': converter.kind = Converter::LevelName; break;
+        case 'c': converter.kind = option.isEmpty() ? Converter::LoggerName : Converter::Reference; break;
+        case 't': converter.kind = Converter::ThreadName; break;
+        case 'x': converter.kind = Converter::Ndc; break;
+        case 'X':
+            converter.kind = option.isEmpty() ? Converter::Reference : Converter::Mdc;
+            converter.text = option;
+            break;
+        case 'F': converter.kind = Converter::FileName; break;
+        case 'M': converter.kind = Converter::FunctionName; break;
+        case 'L': converter.kind = Converter::LineNumber; break;
+        case 'r': converter.kind = Converter::Relative; break;
+        case 'd': converter.kind = Converter::Date; break;
+        case 'n': converter.kind = Converter::Reference; break;
+        default: return false;
+        }
+        converter.reference.reset(new PatternFormatter(p.mid(start, i - start)));
+
+        // %n 与事件无关，直接展开为字面量
+        if (conversion == QLatin1Char('n')) {
+            literal.append(converter.reference->format(LoggingEvent(m_probeLogger, Level(Level::INFO_INT), QString())));
+            continue;
+        }
+        m_converters.push_back(std::move(converter));
+    }
+    flushLiteral();
+    return true;
+}
+
+void FastPatternLayout::verify()
+{
+    const std::vector<LoggingEvent> probes = probeEvents(m_probeLogger);
+
+    // 逐个转换器与参照比对，不一致的改为调用参照
+    QString fast;
+    m_downgraded = 0;
+    for (Converter &converter : m_converters) {
+        if (converter.kind == Converter::Literal || converter.kind == Converter::Reference)
+            continue;
+        for (const LoggingEvent &probe : probes) {
+            fast.clear();
+            append(fast, converter, probe);
+            if (fast != converter.reference->format(probe)) {
+                converter.kind = Converter::Reference;
+                ++m_downgraded;
+                break;
+            }
+        }
+    }
+
+    // 整条模板再比对一次，覆盖字面量与转换器拆分本身
+    PatternFormatter whole(m_pattern);
+    for (const LoggingEvent &probe : probes) {
+        fast.clear();
+        formatCompiled(fast, probe);
+        if (fast != whole.format(probe)) {
+            m_converters.clear();
+            m_fallback.reset(new PatternFormatter(m_pattern));
+            return;
+        }
+    }
+}
+
+void FastPatternLayout::formatCompiled(QString &out, const LoggingEvent &event)
+{
+    for (Converter &converter : m_converters)
+        append(out, converter, event);
+}
+
+void FastPatternLayout::append(QString &out, Converter &converter, const LoggingEvent &event)
+{
+    const int start = out.size();
+    switch (converter.kind) {
+    case Converter::Literal:
+        out.append(converter.text);
+        return;
+    case Converter::Reference:
+        out.append(converter.reference->format(event));
+        return;
+    case Converter::Date:
+        // 参照模板已包含宽度设置，缓存的文本无需再对齐
+        appendDate(out, converter, event.timeStamp());
+        return;
+    case Converter::Message:
+        out.append(event.message());
+        break;
+    case Converter::LevelName:
+        out.append(event.level().toString());
+        break;
+    case Converter::LoggerName: {
+        // Qt 消息等带分类名的事件交给参照处理
+        const Logger *logger = event.logger();
+        const QString category = event.categoryName();
+        if (!category.isEmpty() && (!logger || category != logger->name())) {
+            out.append(converter.reference->format(event));
+            return;
+        }
+        if (logger)
+            out.append(logger->name());
+        break;
+    }
+    case Converter::ThreadName:
+        out.append(event.threadName());
+        break;
+    case Converter::Ndc:
+        out.append(event.ndc());
+        break;
+    case Converter::Mdc:
+        out.append(event.property(converter.text));
+        break;
+    case Converter::FileName:
+        out.append(event.fileName());
+        break;
+    case Converter::FunctionName:
+        out.append(event.functionName());
+        break;
+    case Converter::LineNumber:
+        appendNumber(out, event.lineNumber());
+        break;
+    case Converter::Relative:
+        appendNumber(out, event.timeStamp() - LoggingEvent::startTime());
+        break;
+    }
+
+    // 超出最大宽度时与 log4qt 一样保留左侧，不足最小宽度时补空格
+    const int length = out.size() - start;
+    if (length > converter.maxWidth)
+        out.truncate(start + converter.maxWidth);
+    else if (length < converter.minWidth)
+        appendPadding(out, converter.leftAlign ? out.size() : start, converter.minWidth - length);
+}
+
+void FastPatternLayout::appendDate(QString &out, Converter &converter, qint64 timeStamp)
+{
+    const qint64 second = floorSecond(timeStamp);
+    if (second != converter.cachedSecond) {
+        const qint64  base = second * 1000;
+        const QString zero = referenceDate(converter, base);
+        const QString ones = referenceDate(converter, base + 111);
+        const QString nines = referenceDate(converter, base + 999);
+
+        converter.cachedSecond = second;
+        converter.secondText = zero;
+        converter.millisOffset = kExactMillis;
+        if (zero == ones && zero == nines) {
+            converter.millisOffset = kNoMillis;
+        } else if (zero.size() == ones.size() && zero.size() == nines.size()) {
+            // 三个时刻的差异必须恰好是同一位置上的 000/111/999
+            int first = -1;
+            int count = 0;
+            for (int i = 0; i < zero.size(); ++i) {
+                if (zero.at(i) != ones.at(i) || zero.at(i) != nines.at(i)) {
+                    if (first < 0)
+                        first = i;
+                    ++count;
+                }
+            }
+            if (count == 3 && zero.mid(first, 3) == QLatin1String("000")
+                && ones.mid(first, 3) == QLatin1String("111") && nines.mid(first, 3) == QLatin1String("999"))
+                converter.millisOffset = first;
+        }
+    }
+
+    if (converter.millisOffset == kNoMillis) {
+        out.append(converter.secondText);
+        return;
+    }
+    if (converter.millisOffset == kExactMillis) {
+        if (timeStamp != converter.cachedMsecs) {
+            converter.cachedMsecs = timeStamp;
+            converter.msecsText = referenceDate(converter, timeStamp);
+        }
+        out.append(converter.msecsText);
+        return;
+    }
+
+    const int millis = int(timeStamp - converter.cachedSecond * 1000);
+    const int position = out.size() + converter.millisOffset;
+    out.append(converter.secondText);
+    out[position] = QLatin1Char(char('0' + millis / 100));
+    out[position + 1] = QLatin1Char(char('0' + millis / 10 % 10));
+    out[position + 2] = QLatin1Char(char('0' + millis % 10));
+}
+
+QString FastPatternLayout::referenceDate(const Converter &converter, qint64 timeStamp) const
+{
+    return converter.reference->format(LoggingEvent(m_probeLogger, Level(Level::INFO_INT), QString(), timeStamp));
+}
+} // namespace Log
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include "log4qt/layout.h"
+
+#include <QMutex>
+
+#include <climits>
+#include <memory>
+#include <vector>
+
+namespace Log4Qt {
+class Logger;
+class PatternFormatter;
+} // namespace Log4Qt
+
+/*
+* 预编译的 PatternLayout：
+*   PatternLayout 每条日志都要遍历转换链并从头格式化日期。本类在设置模板时把模板编译成扁平的转换器数组：
+*     字面量与 %n 预先展开；%m %p %c %t %x %X{key} %F %M %L %r 直接取事件字段，数字用 std::to_chars 输出
+*     %d 按秒缓存格式化结果，同一秒内只改写毫秒数字（无法定位毫秒时按毫秒缓存）
+*   输出缓冲区在相邻两条日志之间复用
+*
+*   与 PatternLayout 输出一致的保证：
+*     每个转换器都保留一个只含该转换符的 PatternFormatter 作为参照，编译时用多组探测事件逐个比对，
+*     结果不一致的转换器改为调用参照；整条模板再比对一次，不一致时整体退回 PatternFormatter
+*     日期缓存每秒用参照重新生成，并用 .000/.111/.999 三个时刻校验毫秒位置
+*
+*  log.conf 示例（与 PatternLayout 的 conversionPattern 写法相同）：
+*   log4j.appender.file.layout=Log::FastPatternLayout
+*   log4j.appender.file.layout.ConversionPattern=%d{yyyy-MM-dd hh:mm:ss.zzz} [%-5p] %c - %m%n
+*/
+
+namespace Log {
+class FastPatternLayout : public Log4Qt::Layout
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString conversionPattern READ conversionPattern WRITE setConversionPattern)
+
+public:
+    explicit FastPatternLayout(QObject *parent = nullptr);
+    explicit FastPatternLayout(const QString &pattern, QObject *parent = nullptr);
+    ~FastPatternLayout() override;
+
+    QString conversionPattern() const { return m_pattern; }
+    void    setConversionPattern(const QString &pattern);
+
+    QString format(const Log4Qt::LoggingEvent &event) override;
+
+    // 模板是否已编译（false 表示整体退回 PatternFormatter）
+    bool isCompiled() const { return !m_fallback; }
+    // 自检不一致、改为调用参照的转换器个数（不含 %c{n} 等本就交给参照的转换符）
+    int downgradedCount() const { return m_downgraded; }
+
+private:
+    struct Converter
+    {
+        enum Kind
+        {
+            Literal,
+            Message,
+            LevelName,
+            LoggerName,
+            ThreadName,
+            Ndc,
+            Mdc,
+            FileName,
+            FunctionName,
+            LineNumber,
+            Relative,
+            Date,
+            Reference
+        };
+
+        Kind    kind = Literal;
+        QString text; // 字面量文本或 MDC 键
+        int     minWidth = 0;
+        int     maxWidth = INT_MAX;
+        bool    leftAlign = false;
+
+        // 只含该转换符的 PatternFormatter，用于自检、日期缓存和无法直接处理的情况
+        std::unique_ptr<Log4Qt::PatternFormatter> reference;
+
+        // 日期缓存
+        qint64  cachedSecond = LLONG_MIN;
+        QString secondText;
+        int     millisOffset = -1;
+        qint64  cachedMsecs = LLONG_MIN;
+        QString msecsText;
+    };
+
+    void compile();
+    bool parse();
+    void verify();
+    void append(QString &out, Converter &converter, const Log4Qt::LoggingEvent &event);
+    void appendDate(QString &out, Converter &converter, qint64 timeStamp);
+    void formatCompiled(QString &out, const Log4Qt::LoggingEvent &event);
+
+    QString referenceDate(const Converter &converter, qint64 timeStamp) const;
+
+    QString                                   m_pattern;
+    std::vector<Converter>                    m_converters;
+    std::unique_ptr<Log4Qt::PatternFormatter> m_fallback;
+    Log4Qt::Logger                           *m_probeLogger;
+    int                                       m_downgraded;
+
+    // 同一 Layout 可能被多个 Appender 共用，缓冲区与日期缓存由该锁保护
+    QMutex  m_lock;
+    QString m_buffer;
+};
+} // namespace Log
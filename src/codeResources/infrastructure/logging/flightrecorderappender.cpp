@@ -0,0 +1,587 @@
+﻿#include "flightrecorderappender.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QTimer>
+
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr quint32 kMagic = 0x52544C46; // "FLTR"
+constexpr quint32 kVersion = 1;
+constexpr int     kMinSlotSize = 64;
+constexpr int     kMaxSlotSize = 4096;
+constexpr int     kMaxRecorders = 8;
+
+const int kSignals[] = {SIGSEGV,
+                        SIGABRT,
+                        SIGFPE,
+                        SIGILL,
+#ifdef SIGBUS
+                        SIGBUS
+#endif
+};
+constexpr int kSignalCount = int(sizeof(kSignals) / sizeof(kSignals[0]));
+
+std::atomic<FlightRecorderAppender *> s_recorders[kMaxRecorders];
+std::atomic<bool>                     s_handlersInstalled{false};
+#ifdef Q_OS_WIN
+using SignalHandler = void (*)(int);
+SignalHandler s_previousHandlers[kSignalCount];
+#else
+struct sigaction s_previousActions[kSignalCount];
+// 栈溢出时原栈已不可用，处理函数在备用栈上运行；writeRing 的局部缓冲区约 4KB
+alignas(16) char s_altStack[64 * 1024];
+#endif
+
+using RingHeader = FlightRecorderAppender::RingHeader;
+using SlotHeader = FlightRecorderAppender::SlotHeader;
+
+// 以下函数在信号处理函数中调用，只使用异步信号安全的系统调用，不分配内存
+
+int openForAppend(const char *path)
+{
+#ifdef Q_OS_WIN
+    return _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+void writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+#ifdef Q_OS_WIN
+        const int written = _write(fd, data, unsigned(size));
+#else
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+#endif
+        if (written <= 0)
+            return;
+        data += written;
+        size -= size_t(written);
+    }
+}
+
+void closeFile(int fd)
+{
+#ifdef Q_OS_WIN
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+char *appendText(char *out, const char *text)
+{
+    while (*text)
+        *out++ = *text++;
+    return out;
+}
+
+char *appendNumber(char *out, quint64 value, int width = 1)
+{
+    char digits[20];
+    int  count = 0;
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (int i = count; i < width; ++i)
+        *out++ = '0';
+    while (count > 0)
+        *out++ = digits[--count];
+    return out;
+}
+
+// yyyy-MM-dd hh:mm:ss.zzz，按公历换算，不依赖时区数据库
+char *appendTime(char *out, qint64 msecs)
+{
+    qint64       days = msecs >= 0 ? msecs / 86400000 : -((-msecs + 86399999) / 86400000);
+    const qint64 millisOfDay = msecs - days * 86400000;
+
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const qint64 dayOfEra = days - era * 146097;
+    const qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const qint64 mp = (5 * dayOfYear + 2) / 153;
+    const qint64 day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    const qint64 month = mp < 10 ? mp + 3 : mp - 9;
+    const qint64 year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    out = appendNumber(out, quint64(qMax<qint64>(year, 0)), 4);
+    *out++ = '-';
+    out = appendNumber(out, quint64(month), 2);
+    *out++ = '-';
+    out = appendNumber(out, quint64(day), 2);
+    *out++ = ' ';
+    out = appendNumber(out, quint64(millisOfDay / 3600000), 2);
+    *out++ = ':';
+    out = appendNumber(out, quint64(millisOfDay / 60000 % 60), 2);
+    *out++ = ':';
+    out = appendNumber(out, quint64(millisOfDay / 1000 % 60), 2);
+    *out++ = '.';
+    return appendNumber(out, quint64(millisOfDay % 1000), 3);
+}
+
+const char *levelName(int level)
+{
+    if (level >= Level::OFF_INT)
+        return "OFF";
+    if (level >= Level::FATAL_INT)
+        return "FATAL";
+    if (level >= Level::ERROR_INT)
+        return "ERROR";
+    if (level >= Level::WARN_INT)
+        return "WARN ";
+    if (level >= Level::INFO_INT)
+        return "INFO ";
+    if (level >= Level::DEBUG_INT)
+        return "DEBUG";
+    if (level >= Level::TRACE_INT)
+        return "TRACE";
+    return "ALL  ";
+}
+
+char *slotAt(const RingHeader *ring, quint64 sequence)
+{
+    char *base = reinterpret_cast<char *>(const_cast<RingHeader *>(ring)) + sizeof(RingHeader);
+    return base + (sequence % ring->slotCount) * ring->slotSize;
+}
+
+// 按顺序输出 [from, next) 中仍在环形缓冲区内的事件，返回导出到的序号
+quint64 writeRing(const RingHeader *ring, int fd, quint64 from)
+{
+    const quint64 next = ring->next.load(std::memory_order_acquire);
+    if (next > ring->slotCount && from < next - ring->slotCount)
+        from = next - ring->slotCount;
+
+    const quint32 textCapacity = ring->slotSize - quint32(sizeof(SlotHeader));
+    char          text[kMaxSlotSize];
+    char          prefix[96];
+    for (quint64 n = from; n < next; ++n) {
+        const char *slot = slotAt(ring, n);
+        const auto *header = reinterpret_cast<const SlotHeader *>(slot);
+        const quint64 completed = 2 * n + 2;
+        if (header->sequence.load(std::memory_order_acquire) != completed)
+            continue;
+
+        const qint64  timeStamp = header->timeStamp;
+        const quint64 threadId = header->threadId;
+        const qint32  level = header->level;
+        const quint32 length = qMin(header->length, textCapacity);
+        memcpy(text, slot + sizeof(SlotHeader), length);
+
+        // 复制期间被新事件覆盖则跳过
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) != completed)
+            continue;
+
+        char *p = appendTime(prefix, timeStamp + qint64(ring->utcOffset) * 1000);
+        p = appendText(p, " [");
+        p = appendText(p, levelName(level));
+        p = appendText(p, "] [");
+        p = appendNumber(p, threadId);
+        p = appendText(p, "] ");
+        writeAll(fd, prefix, size_t(p - prefix));
+        writeAll(fd, text, length);
+        writeAll(fd, "\n", 1);
+    }
+    return next;
+}
+
+// 写入 UTF-8，空间不足时在完整字符处截断
+quint32 appendUtf8(char *out, quint32 capacity, quint32 length, const QString &text)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(text.utf16());
+    const ushort *end = p + text.size();
+    while (p < end) {
+        uint code = *p++;
+        if (code >= 0xD800 && code < 0xDC00 && p < end && *p >= 0xDC00 && *p < 0xE000)
+            code = 0x10000 + ((code - 0xD800) << 10) + (*p++ - 0xDC00);
+        else if (code >= 0xD800 && code < 0xE000)
+            code = 0xFFFD;
+
+        if (code < 0x80) {
+            if (length + 1 > capacity)
+                break;
+            out[length++] = char(code);
+        } else if (code < 0x800) {
+            if (length + 2 > capacity)
+                break;
+            out[length++] = char(0xC0 | (code >> 6));
+            out[length++] = char(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            if (length + 3 > capacity)
+                break;
+            out[length++] = char(0xE0 | (code >> 12));
+            out[length++] = char(0x80 | ((code >> 6) & 0x3F));
+            out[length++] = char(0x80 | (code & 0x3F));
+        } else {
+            if (length + 4 > capacity)
+                break;
+            out[length++] = char(0xF0 | (code >> 18));
+            out[length++] = char(0x80 | ((code >> 12) & 0x3F));
+            out[length++] = char(0x80 | ((code >> 6) & 0x3F));
+            out[length++] = char(0x80 | (code & 0x3F));
+        }
+    }
+    return length;
+}
+} // namespace
+
+FlightRecorderAppender::FlightRecorderAppender(QObject *parent)
+    : AppenderSkeleton(false, parent)
+    , m_capacity(4096)
+    , m_slotSize(512)
+    , m_dumpFile(QStringLiteral("flightrecorder.log"))
+    , m_dumpLevel(Level::ERROR_INT)
+    , m_dumpInterval(1000)
+    , m_handleSignals(true)
+    , m_ring(nullptr)
+    , m_hasFilters(false)
+    , m_dumpThreshold(Level::ERROR_INT)
+    , m_dumped(0)
+    , m_dumpIntervalValue(1000)
+    , m_lastEventDump(-1)
+    , m_dumpPending(false)
+    , m_dumpPath(m_dumpPathBuffers[0])
+{
+    m_dumpPathBuffers[0][0] = '\0';
+    m_dumpPathBuffers[1][0] = '\0';
+    m_clock.start();
+}
+
+FlightRecorderAppender::~FlightRecorderAppender()
+{
+    close();
+}
+
+void FlightRecorderAppender::activateOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+
+    if (!m_ring) {
+        if (!createRing()) {
+            logger()->error(QStringLiteral("Failed to allocate flight recorder ring for appender '%1'"), name());
+            return;
+        }
+    } else if (quint32(m_capacity) != m_ring->slotCount) {
+        logger()->warn(QStringLiteral("Capacity of flight recorder '%1' only takes effect on first activation"),
+                       name());
+    }
+
+    const QFileInfo fileInfo(m_dumpFile);
+    QDir().mkpath(fileInfo.absolutePath());
+    const QByteArray path = QFile::encodeName(fileInfo.absoluteFilePath());
+    const char      *current = m_dumpPath.load(std::memory_order_acquire);
+    if (qstrcmp(current, path.constData()) != 0) {
+        // 信号处理函数可能正在读取当前路径，写入另一块缓冲区后再发布
+        char *buffer = current == m_dumpPathBuffers[0] ? m_dumpPathBuffers[1] : m_dumpPathBuffers[0];
+        qstrncpy(buffer, path.constData(), sizeof(m_dumpPathBuffers[0]));
+        m_dumpPath.store(buffer, std::memory_order_release);
+    }
+    m_dumpThreshold.store(m_dumpLevel.toInt(), std::memory_order_relaxed);
+    m_dumpIntervalValue.store(qMax(0, m_dumpInterval), std::memory_order_relaxed);
+
+    bool registered = false;
+    for (auto &slot : s_recorders)
+        registered = registered || slot.load() == this;
+    for (int i = 0; i < kMaxRecorders && !registered; ++i) {
+        FlightRecorderAppender *expected = nullptr;
+        registered = s_recorders[i].compare_exchange_strong(expected, this);
+    }
+    if (m_handleSignals)
+        installSignalHandlers();
+
+    AppenderSkeleton::activateOptions();
+}
+
+void FlightRecorderAppender::close()
+{
+    QMutexLocker locker(&mObjectGuard);
+    if (isClosed())
+        return;
+    for (auto &slot : s_recorders) {
+        FlightRecorderAppender *expected = this;
+        slot.compare_exchange_strong(expected, nullptr);
+    }
+    AppenderSkeleton::close();
+}
+
+void FlightRecorderAppender::addFilter(const FilterSharedPtr &filter)
+{
+    AppenderSkeleton::addFilter(filter);
+    m_hasFilters.store(true);
+}
+
+void FlightRecorderAppender::clearFilters()
+{
+    AppenderSkeleton::clearFilters();
+    m_hasFilters.store(false);
+}
+
+void FlightRecorderAppender::doAppend(const LoggingEvent &event)
+{
+    if (!m_ring || !isActive() || isClosed() || !isAsSevereAsThreshold(event.level()))
+        return;
+    if (m_hasFilters.load(std::memory_order_relaxed)) {
+        for (FilterSharedPtr filter = this->filter(); filter; filter = filter->next()) {
+            const Filter::Decision decision = filter->decide(event);
+            if (decision == Filter::DENY)
+                return;
+            if (decision == Filter::ACCEPT)
+                break;
+        }
+    }
+
+    record(event);
+    if (event.level().toInt() >= m_dumpThreshold.load(std::memory_order_relaxed))
+        dumpOnEvent();
+}
+
+void FlightRecorderAppender::append(const LoggingEvent &event)
+{
+    record(event);
+}
+
+void FlightRecorderAppender::dump()
+{
+    dumpTo(m_dumpPath.load(std::memory_order_acquire), ReasonApi, 0);
+}
+
+void FlightRecorderAppender::dumpAll()
+{
+    for (auto &slot : s_recorders) {
+        if (FlightRecorderAppender *recorder = slot.load())
+            recorder->dumpTo(recorder->m_dumpPath.load(std::memory_order_acquire), ReasonApi, 0);
+    }
+}
+
+bool FlightRecorderAppender::dumpSharedMemory(const QString &key, const QString &fileName)
+{
+    QSharedMemory memory(key);
+    if (!memory.attach(QSharedMemory::ReadOnly))
+        return false;
+
+    const auto *ring = static_cast<const RingHeader *>(memory.constData());
+    if (memory.size() < int(sizeof(RingHeader)) || ring->magic != kMagic || ring->version != kVersion
+        || ring->slotSize > quint32(kMaxSlotSize) || ring->slotSize <= sizeof(SlotHeader) || ring->slotCount == 0
+        || qint64(memory.size()) < qint64(sizeof(RingHeader)) + qint64(ring->slotSize) * ring->slotCount)
+        return false;
+
+    const int fd = openForAppend(QFile::encodeName(fileName).constData());
+    if (fd < 0)
+        return false;
+    static const char title[] = "---- flight recorder dump: watchdog ----\n";
+    writeAll(fd, title, sizeof(title) - 1);
+    writeRing(ring, fd, 0);
+    closeFile(fd);
+    return true;
+}
+
+bool FlightRecorderAppender::createRing()
+{
+    const quint32 slotSize = quint32(qBound(kMinSlotSize, m_slotSize, kMaxSlotSize) + 7) & ~7u;
+    const quint32 slotCount = quint32(qMax(1, m_capacity));
+    const qint64  size = qint64(sizeof(RingHeader)) + qint64(slotSize) * slotCount;
+    if (size > INT_MAX)
+        return false;
+
+    char *memory = nullptr;
+    bool  attached = false;
+    if (!m_sharedMemoryKey.isEmpty()) {
+        m_sharedMemory.setKey(m_sharedMemoryKey);
+        if (m_sharedMemory.create(int(size))) {
+            memory = static_cast<char *>(m_sharedMemory.data());
+        } else if (m_sharedMemory.error() == QSharedMemory::AlreadyExists && m_sharedMemory.attach()
+                   && m_sharedMemory.size() >= size) {
+            memory = static_cast<char *>(m_sharedMemory.data());
+            attached = true;
+        } else {
+            logger()->warn(QStringLiteral("Shared memory '%1' unavailable (%2), flight recorder stays in process"),
+                           m_sharedMemoryKey,
+                           m_sharedMemory.errorString());
+            if (m_sharedMemory.isAttached())
+                m_sharedMemory.detach();
+        }
+    }
+    if (!memory) {
+        m_memory.reset(new (std::nothrow) char[size_t(size)]);
+        memory = m_memory.get();
+        if (!memory)
+            return false;
+    }
+
+    // 上次运行遗留的同格式段保留原有内容，看门狗仍可取出；本进程只导出新写入的事件
+    auto *ring = reinterpret_cast<RingHeader *>(memory);
+    if (!attached || ring->magic != kMagic || ring->version != kVersion || ring->slotSize != slotSize
+        || ring->slotCount != slotCount) {
+        memset(memory, 0, size_t(size));
+        ring = new (memory) RingHeader{kMagic, kVersion, slotSize, slotCount, 0, 0, {0}};
+    }
+    ring->utcOffset = QDateTime::currentDateTime().offsetFromUtc();
+    m_dumped.store(ring->next.load());
+    m_ring = ring;
+    return true;
+}
+
+void FlightRecorderAppender::record(const LoggingEvent &event)
+{
+    RingHeader   *ring = m_ring;
+    const quint64 n = ring->next.fetch_add(1, std::memory_order_relaxed);
+    char         *slot = slotAt(ring, n);
+    auto         *header = reinterpret_cast<SlotHeader *>(slot);
+
+    header->sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->timeStamp = event.timeStamp();
+    header->threadId = quint64(quintptr(QThread::currentThreadId()));
+    header->level = event.level().toInt();
+
+    char         *text = slot + sizeof(SlotHeader);
+    const quint32 capacity = ring->slotSize - quint32(sizeof(SlotHeader));
+    quint32       length = appendUtf8(text, capacity, 0, event.loggename());
+    if (length + 3 <= capacity) {
+        memcpy(text + length, " - ", 3);
+        length += 3;
+    }
+    header->length = appendUtf8(text, capacity, length, event.message());
+
+    header->sequence.store(2 * n + 2, std::memory_order_release);
+}
+
+void FlightRecorderAppender::dumpOnEvent()
+{
+    const int    interval = m_dumpIntervalValue.load(std::memory_order_relaxed);
+    const qint64 now = m_clock.elapsed();
+    qint64       last = m_lastEventDump.load(std::memory_order_relaxed);
+    const qint64 wait = last < 0 ? 0 : last + interval - now;
+    if (wait <= 0 && m_lastEventDump.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        dumpTo(m_dumpPath.load(std::memory_order_acquire), ReasonEvent, 0);
+        return;
+    }
+
+    // 间隔内的触发只安排一次延迟导出，期间的事件已在环形缓冲区中，随那次导出一起写出
+    if (m_dumpPending.exchange(true, std::memory_order_acq_rel))
+        return;
+    const int delay = int(wait > 0 ? wait : interval);
+    QMetaObject::invokeMethod(
+        this,
+        [this, delay]() {
+            QTimer::singleShot(delay, this, [this]() {
+                m_dumpPending.store(false, std::memory_order_release);
+                m_lastEventDump.store(m_clock.elapsed(), std::memory_order_relaxed);
+                dumpTo(m_dumpPath.load(std::memory_order_acquire), ReasonEvent, 0);
+            });
+        },
+        Qt::QueuedConnection);
+}
+
+void FlightRecorderAppender::dumpTo(const char *path, Reason reason, int signal)
+{
+    // 同一记录器不并发导出（包括导出过程中崩溃再次进入信号处理函数）
+    RingHeader *ring = m_ring;
+    if (!ring || !path || !path[0] || m_dumping.test_and_set(std::memory_order_acquire))
+        return;
+
+    const int fd = openForAppend(path);
+    if (fd >= 0) {
+        char  title[64];
+        char *p = appendText(title, "---- flight recorder dump: ");
+        switch (reason) {
+        case ReasonApi: p = appendText(p, "api"); break;
+        case ReasonEvent: p = appendText(p, "event"); break;
+        case ReasonSignal:
+            p = appendText(p, "signal ");
+            p = appendNumber(p, quint64(signal));
+            break;
+        }
+        p = appendText(p, " ----\n");
+        writeAll(fd, title, size_t(p - title));
+        m_dumped.store(writeRing(ring, fd, m_dumped.load()));
+        closeFile(fd);
+    }
+    m_dumping.clear(std::memory_order_release);
+}
+
+void FlightRecorderAppender::installSignalHandlers()
+{
+    if (s_handlersInstalled.exchange(true))
+        return;
+#ifdef Q_OS_WIN
+    for (int i = 0; i < kSignalCount; ++i) {
+        const SignalHandler previous = std::signal(kSignals[i], &FlightRecorderAppender::signalHandler);
+        s_previousHandlers[i] = previous == SIG_ERR ? SIG_DFL : previous;
+    }
+#else
+    // 备用栈只对当前线程生效，线程已有备用栈时保留
+    stack_t current;
+    if (sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE)) {
+        stack_t stack{};
+        stack.ss_sp = s_altStack;
+        stack.ss_size = sizeof(s_altStack);
+        sigaltstack(&stack, nullptr);
+    }
+
+    struct sigaction action{};
+    action.sa_handler = &FlightRecorderAppender::signalHandler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < kSignalCount; ++i) {
+        if (sigaction(kSignals[i], &action, &s_previousActions[i]) != 0) {
+            s_previousActions[i] = {};
+            s_previousActions[i].sa_handler = SIG_DFL;
+            sigemptyset(&s_previousActions[i].sa_mask);
+        }
+    }
+#endif
+}
+
+void FlightRecorderAppender::signalHandler(int signal)
+{
+    for (auto &slot : s_recorders) {
+        if (FlightRecorderAppender *recorder = slot.load())
+            recorder->dumpTo(recorder->m_dumpPath.load(std::memory_order_acquire), ReasonSignal, signal);
+    }
+
+    // 恢复原处理函数后重新触发，保留原有的崩溃处理（core dump、崩溃报告等）；
+    // POSIX 下信号在处理函数返回后才递送给恢复的处理函数
+    for (int i = 0; i < kSignalCount; ++i) {
+        if (kSignals[i] != signal)
+            continue;
+#ifdef Q_OS_WIN
+        std::signal(signal, s_previousHandlers[i]);
+#else
+        sigaction(signal, &s_previousActions[i], nullptr);
+#endif
+    }
+    std::raise(signal);
+}
+} // namespace Log
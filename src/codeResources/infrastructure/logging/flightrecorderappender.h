@@ -0,0 +1,166 @@
+﻿#pragma once
+
+#include "log4qt/appenderskeleton.h"
+
+#include <QElapsedTimer>
+#include <QSharedMemory>
+
+#include <atomic>
+#include <memory>
+
+/*
+* 飞行记录器Appender：
+*   在内存环形缓冲区中保留最近 capacity 条事件（所有级别），平时不写磁盘，出问题时再导出
+*   写入无锁：每条事件占用一个固定大小的槽位，序号由原子计数分配，消息直接编码为 UTF-8 写入槽位，
+*   超出槽位的部分截断；doAppend 不经过 AppenderSkeleton 的对象锁
+*   以下情况把尚未导出的事件追加到 dumpFile：
+*     收到致命信号（SIGSEGV/SIGABRT/SIGFPE/SIGILL/SIGBUS），导出只使用 open/write 等异步信号安全的调用
+*     事件级别不低于 dumpLevel（默认 ERROR），每 dumpInterval 毫秒（默认 1000）最多导出一次，
+*       间隔内的其余触发合并到间隔结束时在 Appender 所在线程导出一次
+*     调用 dump() 或 dumpAll()
+*   设置 sharedMemoryKey 后环形缓冲区放在共享内存段中，看门狗进程可用 dumpSharedMemory() 取出
+*   （Windows 下共享内存随最后一个句柄释放，看门狗需在崩溃前 attach）
+*   POSIX 下信号处理函数用 sigaction 安装并带 SA_ONSTACK，安装处理函数的线程（首次激活的线程）
+*   没有备用栈时为其设置一个，栈溢出时仍能导出；其他线程需要自行调用 sigaltstack
+*
+*   只有进入 Appender 的事件才会被记录，logger 级别需放开到 DEBUG，磁盘 Appender 用 threshold 控制级别
+*   capacity、slotSize、sharedMemoryKey 只在首次激活时生效，其余属性可在运行时修改后调用 applyOptions()
+*
+*  log.conf 示例：
+*   log4j.rootLogger=DEBUG, file, recorder
+*   log4j.appender.file.threshold=WARN
+*   log4j.appender.recorder=Log::FlightRecorderAppender
+*   log4j.appender.recorder.capacity=4096
+*   log4j.appender.recorder.slotSize=512
+*   log4j.appender.recorder.dumpFile=logs/flight.log
+*   log4j.appender.recorder.dumpLevel=ERROR
+*   log4j.appender.recorder.dumpInterval=1000
+*   log4j.appender.recorder.sharedMemoryKey=MyApp.FlightRecorder
+*/
+
+namespace Log {
+class FlightRecorderAppender : public Log4Qt::AppenderSkeleton
+{
+    Q_OBJECT
+    Q_CLASSINFO("LiveOptions", "dumpFile,dumpLevel,dumpInterval,handleSignals")
+
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity)
+    Q_PROPERTY(int slotSize READ slotSize WRITE setSlotSize)
+    Q_PROPERTY(QString dumpFile READ dumpFile WRITE setDumpFile)
+    Q_PROPERTY(Log4Qt::Level dumpLevel READ dumpLevel WRITE setDumpLevel)
+    Q_PROPERTY(int dumpInterval READ dumpInterval WRITE setDumpInterval)
+    Q_PROPERTY(QString sharedMemoryKey READ sharedMemoryKey WRITE setSharedMemoryKey)
+    Q_PROPERTY(bool handleSignals READ handleSignals WRITE setHandleSignals)
+
+public:
+    explicit FlightRecorderAppender(QObject *parent = nullptr);
+    ~FlightRecorderAppender() override;
+
+    int           capacity() const { return m_capacity; }
+    int           slotSize() const { return m_slotSize; }
+    QString       dumpFile() const { return m_dumpFile; }
+    Log4Qt::Level dumpLevel() const { return m_dumpLevel; }
+    int           dumpInterval() const { return m_dumpInterval; }
+    QString       sharedMemoryKey() const { return m_sharedMemoryKey; }
+    bool          handleSignals() const { return m_handleSignals; }
+
+    void setCapacity(int capacity) { m_capacity = capacity; }
+    void setSlotSize(int bytes) { m_slotSize = bytes; }
+    void setDumpFile(const QString &fileName) { m_dumpFile = fileName; }
+    void setDumpLevel(Log4Qt::Level level) { m_dumpLevel = level; }
+    void setDumpInterval(int msecs) { m_dumpInterval = msecs; }
+    void setSharedMemoryKey(const QString &key) { m_sharedMemoryKey = key; }
+    void setHandleSignals(bool handle) { m_handleSignals = handle; }
+
+    bool requiresLayout() const override { return false; }
+    void activateOptions() override;
+    void close() override;
+
+    // 重新激活不会重建环形缓冲区，已记录的事件保留
+    Q_INVOKABLE void applyOptions() { activateOptions(); }
+
+    void addFilter(const Log4Qt::FilterSharedPtr &filter) override;
+    void clearFilters() override;
+
+    // 不经过对象锁，级别与过滤器判定后直接写入环形缓冲区
+    void doAppend(const Log4Qt::LoggingEvent &event) override;
+
+    // 把尚未导出的事件追加到 dumpFile
+    void dump();
+
+    // 导出所有飞行记录器，信号处理函数中也使用此函数
+    static void dumpAll();
+
+    // 看门狗进程使用：从共享内存段中读取全部事件写入 fileName
+    static bool dumpSharedMemory(const QString &key, const QString &fileName);
+
+    // 共享内存段的布局，看门狗按此解析
+    struct RingHeader
+    {
+        quint32              magic;
+        quint32              version;
+        quint32              slotSize;
+        quint32              slotCount;
+        qint32               utcOffset; // 秒，导出时把时间戳换算为本地时间
+        quint32              reserved;
+        std::atomic<quint64> next; // 下一条事件的序号
+    };
+
+    struct SlotHeader
+    {
+        std::atomic<quint64> sequence; // 2n+1 写入中，2n+2 已写完第 n 条事件
+        qint64               timeStamp;
+        quint64              threadId;
+        qint32               level;
+        quint32              length; // 其后 UTF-8 文本的字节数
+    };
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+
+private:
+    enum Reason
+    {
+        ReasonApi,
+        ReasonEvent,
+        ReasonSignal
+    };
+
+    bool createRing();
+    void record(const Log4Qt::LoggingEvent &event);
+    void dumpTo(const char *path, Reason reason, int signal);
+    void dumpOnEvent();
+
+    static void installSignalHandlers();
+    static void signalHandler(int signal);
+
+    int           m_capacity;
+    int           m_slotSize;
+    QString       m_dumpFile;
+    Log4Qt::Level m_dumpLevel;
+    int           m_dumpInterval;
+    QString       m_sharedMemoryKey;
+    bool          m_handleSignals;
+
+    // 环形缓冲区，位于 m_memory 或 m_sharedMemory 中
+    RingHeader             *m_ring;
+    std::unique_ptr<char[]> m_memory;
+    QSharedMemory           m_sharedMemory;
+
+    std::atomic<bool>    m_hasFilters;
+    std::atomic<int>     m_dumpThreshold;
+    std::atomic<quint64> m_dumped; // 已导出到的序号
+    std::atomic_flag     m_dumping = ATOMIC_FLAG_INIT;
+
+    // 按事件导出的节流
+    QElapsedTimer       m_clock;
+    std::atomic<int>    m_dumpIntervalValue;
+    std::atomic<qint64> m_lastEventDump; // m_clock 毫秒，-1 表示尚未导出
+    std::atomic<bool>   m_dumpPending;
+
+    // 信号处理函数中不能转换 QString，预先编码；两块缓冲区交替写入，
+    // 写好后原子发布指针，信号处理函数读到的总是完整的路径
+    std::atomic<const char *> m_dumpPath;
+    char                      m_dumpPathBuffers[2][1024];
+};
+} // namespace Log
@@ -0,0 +1,259 @@
+﻿#include "groupcommitfileappender.h"
+#include "logindexreader.h"
+#include "logmetrics.h"
+#include "log4qt/helpers/optionconverter.h"
+#include "log4qt/layout.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QFileDevice>
+#include <QTextStream>
+#include <QTimer>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Log {
+using namespace Log4Qt;
+
+GroupCommitFileAppender::GroupCommitFileAppender(QObject *parent)
+    : FileAppender(parent)
+    , m_flushBytes(64 * 1024)
+    , m_flushEvents(256)
+    , m_flushInterval(1000)
+    , m_syncInterval(0)
+    , m_flushLevel(Level::ERROR_INT)
+    , m_pendingBytes(0)
+    , m_pendingEvents(0)
+    , m_unsynced(false)
+    , m_flushTimer(new QTimer(this))
+    , m_indexInterval(0)
+    , m_sinceIndex(0)
+    , m_lastIndexTime(0)
+    , m_bytesCounter(-1)
+{
+    setImmediateFlush(false);
+    connect(m_flushTimer, &QTimer::timeout, this, &GroupCommitFileAppender::onFlushTimer);
+}
+
+GroupCommitFileAppender::GroupCommitFileAppender(const LayoutSharedPtr &layout,
+                                                 const QString         &fileName,
+                                                 QObject               *parent)
+    : GroupCommitFileAppender(parent)
+{
+    setLayout(layout);
+    setFile(fileName);
+}
+
+GroupCommitFileAppender::~GroupCommitFileAppender()
+{
+    close();
+}
+
+void GroupCommitFileAppender::setIndexInterval(const QString &size)
+{
+    bool         ok;
+    const qint64 value = OptionConverter::toFileSize(size, &ok);
+    if (ok)
+        m_indexInterval = value;
+}
+
+void GroupCommitFileAppender::activateOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+
+    // 刷新由组提交策略接管，配置文件中的 immediateFlush 不再生效
+    setImmediateFlush(false);
+    FileAppender::activateOptions();
+
+    m_pendingBytes = 0;
+    m_pendingEvents = 0;
+    m_unsynced = false;
+    m_lastFlush.start();
+    m_lastSync.start();
+    m_bytesCounter = LogMetrics::counter(LogMetrics::Bytes, name());
+    restartFlushTimer();
+}
+
+void GroupCommitFileAppender::applyOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+    // 其余阈值在每次提交时读取，只需按新的 flushInterval 重启定时器
+    restartFlushTimer();
+}
+
+void GroupCommitFileAppender::restartFlushTimer()
+{
+    // 定时器只能在所属线程启停，空闲时也能保证 flushInterval 内落到文件
+    const int interval = m_flushInterval;
+    QMetaObject::invokeMethod(m_flushTimer, [this, interval]() {
+        if (interval > 0)
+            m_flushTimer->start(interval);
+        else
+            m_flushTimer->stop();
+    });
+}
+
+void GroupCommitFileAppender::close()
+{
+    QMutexLocker locker(&mObjectGuard);
+    if (isClosed())
+        return;
+    if (writer())
+        flushLocked(true);
+    FileAppender::close();
+    closeIndex();
+}
+
+void GroupCommitFileAppender::flush(bool sync)
+{
+    QMutexLocker locker(&mObjectGuard);
+    if (isClosed() || !writer())
+        return;
+    flushLocked(sync);
+}
+
+void GroupCommitFileAppender::append(const LoggingEvent &event)
+{
+    indexEvent(event.timeStamp());
+
+    const QString message(layout()->format(event));
+    *writer() << message;
+    if (handleIoErrors())
+        return;
+
+    // 按 UTF-16 字符数估算字节数，ASCII 日志下与实际一致
+    commit(message.size(), event.level());
+}
+
+void GroupCommitFileAppender::commit(qint64 bytes, Level level)
+{
+    m_pendingBytes += bytes;
+    m_sinceIndex += bytes;
+    ++m_pendingEvents;
+    LogMetrics::add(m_bytesCounter, quint64(bytes));
+
+    if (level >= m_flushLevel) {
+        flushLocked(true);
+        return;
+    }
+    if (m_pendingBytes >= m_flushBytes || m_pendingEvents >= m_flushEvents
+        || (m_flushInterval > 0 && m_lastFlush.hasExpired(m_flushInterval)))
+        flushLocked(false);
+}
+
+void GroupCommitFileAppender::flushLocked(bool sync)
+{
+    if (m_pendingEvents > 0) {
+        writer()->flush();
+        if (handleIoErrors())
+            return;
+        m_unsynced = true;
+    }
+    m_pendingBytes = 0;
+    m_pendingEvents = 0;
+    m_lastFlush.restart();
+
+    if (!m_unsynced || m_syncInterval <= 0)
+        return;
+    if (sync || m_lastSync.hasExpired(m_syncInterval)) {
+        syncFile();
+        m_unsynced = false;
+        m_lastSync.restart();
+    }
+}
+
+void GroupCommitFileAppender::openFile()
+{
+    closeIndex();
+    FileAppender::openFile();
+    openIndex();
+}
+
+void GroupCommitFileAppender::openIndex()
+{
+    if (m_indexInterval <= 0 || !writer())
+        return;
+
+    m_index.setFileName(LogIndexReader::indexFileName(file()));
+    if (!m_index.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        logger()->warn(QStringLiteral("Unable to open index file '%1' for appender '%2': %3"),
+                       m_index.fileName(),
+                       name(),
+                       m_index.errorString());
+        return;
+    }
+
+    // 截断日志时索引作废；崩溃留下的半条记录和指向日志末尾之后的记录一并去掉
+    const qint64 logSize = writer()->device()->size();
+    qint64       count = m_index.size() / LogIndexReader::kRecordSize;
+    m_lastIndexTime = 0;
+    while (count > 0) {
+        uchar record[LogIndexReader::kRecordSize];
+        m_index.seek((count - 1) * LogIndexReader::kRecordSize);
+        if (m_index.read(reinterpret_cast<char *>(record), sizeof(record)) == qint64(sizeof(record))
+            && qFromLittleEndian<qint64>(record + 8) < logSize) {
+            m_lastIndexTime = qFromLittleEndian<qint64>(record);
+            break;
+        }
+        --count;
+    }
+    m_index.resize(count * LogIndexReader::kRecordSize);
+    m_index.seek(m_index.size());
+
+    // 新打开的文件从第一条事件开始建立索引
+    m_sinceIndex = m_indexInterval;
+}
+
+void GroupCommitFileAppender::closeIndex()
+{
+    m_index.close();
+}
+
+void GroupCommitFileAppender::indexEvent(qint64 timeStamp)
+{
+    if (m_sinceIndex < m_indexInterval || !m_index.isOpen())
+        return;
+
+    // 偏移取自文件位置，需先把缓冲区写出；默认间隔远大于单条消息，额外刷新的次数可以忽略
+    flushLocked(false);
+    const qint64 offset = writer()->device()->pos();
+
+    // 多线程下事件时间戳不保证严格有序，索引只记录单调不减的时间以便二分查找
+    m_lastIndexTime = qMax(timeStamp, m_lastIndexTime);
+
+    uchar record[LogIndexReader::kRecordSize];
+    qToLittleEndian<qint64>(m_lastIndexTime, record);
+    qToLittleEndian<qint64>(offset, record + 8);
+    if (m_index.write(reinterpret_cast<const char *>(record), sizeof(record)) != qint64(sizeof(record))) {
+        m_index.close();
+        return;
+    }
+    m_sinceIndex = 0;
+}
+
+void GroupCommitFileAppender::onFlushTimer()
+{
+    QMutexLocker locker(&mObjectGuard);
+    if (isClosed() || !writer())
+        return;
+    if (m_pendingEvents > 0 || (m_unsynced && m_syncInterval > 0 && m_lastSync.hasExpired(m_syncInterval)))
+        flushLocked(false);
+}
+
+bool GroupCommitFileAppender::syncFile()
+{
+    auto *file = qobject_cast<QFileDevice *>(writer()->device());
+    if (!file || !file->flush())
+        return false;
+#ifdef Q_OS_WIN
+    return ::_commit(file->handle()) == 0;
+#else
+    return ::fsync(file->handle()) == 0;
+#endif
+}
+} // namespace Log
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include "log4qt/fileappender.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+
+class QTimer;
+
+/*
+* 组提交文件Appender：
+*   WriterAppender::immediateFlush 只有"每行刷新"和"从不刷新"两种选择，
+*   本类按组提交策略刷新，以下条件任一满足即刷新：
+*     缓冲字节数达到 flushBytes、缓冲事件数达到 flushEvents、距上次刷新超过 flushInterval 毫秒
+*   syncInterval > 0 时按该间隔调用 fsync 落盘（0 表示不主动落盘）
+*   级别不低于 flushLevel（默认 ERROR）的事件总是立即刷新，开启落盘时同时 fsync
+*   indexInterval > 0 时每写入约该字节数在 <file>.idx 中记录一条（时间戳, 偏移）索引，
+*   用 LogIndexReader 按时间跳转（见 logindexreader.h）；默认 0 不写索引
+*   LiveOptions 中的属性可在运行时修改后调用 applyOptions() 生效，不会重新打开文件（log.conf 增量重新加载使用）
+*
+*  log.conf 示例：
+*   log4j.appender.file=Log::GroupCommitFileAppender
+*   log4j.appender.file.file=logs/app.log
+*   log4j.appender.file.flushBytes=65536
+*   log4j.appender.file.flushEvents=256
+*   log4j.appender.file.flushInterval=1000
+*   log4j.appender.file.syncInterval=5000
+*   log4j.appender.file.flushLevel=ERROR
+*   log4j.appender.file.indexInterval=64KB
+*/
+
+namespace Log {
+class GroupCommitFileAppender : public Log4Qt::FileAppender
+{
+    Q_OBJECT
+    Q_CLASSINFO("LiveOptions", "flushBytes,flushEvents,flushInterval,syncInterval,flushLevel")
+
+    Q_PROPERTY(int flushBytes READ flushBytes WRITE setFlushBytes)
+    Q_PROPERTY(int flushEvents READ flushEvents WRITE setFlushEvents)
+    Q_PROPERTY(int flushInterval READ flushInterval WRITE setFlushInterval)
+    Q_PROPERTY(int syncInterval READ syncInterval WRITE setSyncInterval)
+    Q_PROPERTY(Log4Qt::Level flushLevel READ flushLevel WRITE setFlushLevel)
+    Q_PROPERTY(QString indexInterval READ indexInterval WRITE setIndexInterval)
+
+public:
+    explicit GroupCommitFileAppender(QObject *parent = nullptr);
+    GroupCommitFileAppender(const Log4Qt::LayoutSharedPtr &layout,
+                            const QString                 &fileName,
+                            QObject                       *parent = nullptr);
+    ~GroupCommitFileAppender() override;
+
+    int           flushBytes() const { return m_flushBytes; }
+    int           flushEvents() const { return m_flushEvents; }
+    int           flushInterval() const { return m_flushInterval; }
+    int           syncInterval() const { return m_syncInterval; }
+    Log4Qt::Level flushLevel() const { return m_flushLevel; }
+    QString       indexInterval() const { return QString::number(m_indexInterval); }
+
+    void setFlushBytes(int bytes) { m_flushBytes = bytes; }
+    void setFlushEvents(int events) { m_flushEvents = events; }
+    void setFlushInterval(int msecs) { m_flushInterval = msecs; }
+    void setSyncInterval(int msecs) { m_syncInterval = msecs; }
+    void setFlushLevel(Log4Qt::Level level) { m_flushLevel = level; }
+    void setIndexInterval(const QString &size);
+
+    void activateOptions() override;
+    void close() override;
+
+    // 应用运行时修改的 LiveOptions，不重新打开文件
+    Q_INVOKABLE virtual void applyOptions();
+
+    // 立即刷新缓冲区，sync 为 true 时同时落盘
+    void flush(bool sync = false);
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+    void openFile() override;
+
+    // 消息已写入 writer 后调用，按策略决定是否刷新（调用方需持有 mObjectGuard）
+    void commit(qint64 bytes, Log4Qt::Level level);
+
+    // 刷新缓冲区并重置计数（调用方需持有 mObjectGuard）
+    void flushLocked(bool sync);
+
+    // 消息写入 writer 之前调用，距上条索引已写入 indexInterval 字节时记录本条的时间与偏移
+    void indexEvent(qint64 timeStamp);
+    void openIndex();
+    void closeIndex();
+
+private:
+    void onFlushTimer();
+    void restartFlushTimer();
+    bool syncFile();
+
+    int           m_flushBytes;
+    int           m_flushEvents;
+    int           m_flushInterval;
+    int           m_syncInterval;
+    Log4Qt::Level m_flushLevel;
+
+    qint64        m_pendingBytes;
+    int           m_pendingEvents;
+    bool          m_unsynced;
+    QElapsedTimer m_lastFlush;
+    QElapsedTimer m_lastSync;
+    QTimer       *m_flushTimer;
+
+    qint64 m_indexInterval;
+    qint64 m_sinceIndex;
+    qint64 m_lastIndexTime;
+    QFile  m_index;
+
+    int m_bytesCounter; // LogMetrics 计数器编号
+};
+} // namespace Log
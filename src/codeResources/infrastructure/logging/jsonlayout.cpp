@@ -0,0 +1,179 @@
+﻿#include "jsonlayout.h"
+#include "log4qt/loggingevent.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr int kSecondLength = 19; // yyyy-MM-ddThh:mm:ss
+
+// 过滤器等内部使用的事件属性（采样标记、限流汇总标记）以此开头，不输出到 mdc
+const QString kInternalPrefix = QStringLiteral("log.");
+
+// rapidjson 遇到不成对的代理项会中止写入并留下残缺的 JSON，替换为 U+FFFD；没有代理项时直接共享原字符串
+QString validUtf16(const QString &text)
+{
+    const QChar *data = text.constData();
+    const int    size = text.size();
+    int          i = 0;
+    while (i < size && !data[i].isSurrogate())
+        ++i;
+    if (i == size)
+        return text;
+
+    QString result = text;
+    for (; i < size; ++i) {
+        if (!data[i].isSurrogate())
+            continue;
+        if (data[i].isHighSurrogate() && i + 1 < size && data[i + 1].isLowSurrogate())
+            ++i;
+        else
+            result[i] = QChar(QChar::ReplacementCharacter);
+    }
+    return result;
+}
+
+template<typename Writer>
+void writeKey(Writer &writer, const char16_t *key, int length)
+{
+    writer.Key(key, rapidjson::SizeType(length));
+}
+
+template<typename Writer>
+void writeKey(Writer &writer, const QString &key)
+{
+    const QString text = validUtf16(key);
+    writer.Key(reinterpret_cast<const char16_t *>(text.utf16()), rapidjson::SizeType(text.size()));
+}
+
+template<typename Writer>
+void writeString(Writer &writer, const QString &value)
+{
+    const QString text = validUtf16(value);
+    writer.String(reinterpret_cast<const char16_t *>(text.utf16()), rapidjson::SizeType(text.size()));
+}
+} // namespace
+
+JsonLayout::JsonLayout(QObject *parent)
+    : Layout(parent)
+    , m_utf16Writer(m_utf16Buffer)
+    , m_utf8Writer(m_utf8Buffer)
+{
+    const QString endOfLine = Layout::endOfLine();
+    m_endOfLineLength = qMin(endOfLine.size(), 2);
+    for (int i = 0; i < m_endOfLineLength; ++i)
+        m_endOfLine[i] = char16_t(endOfLine.at(i).unicode());
+    m_endOfLine[m_endOfLineLength] = u'\0';
+    m_timeText[kTimeLength] = u'\0';
+}
+
+QString JsonLayout::contentType() const
+{
+    return QStringLiteral("application/x-ndjson");
+}
+
+QString JsonLayout::format(const LoggingEvent &event)
+{
+    QMutexLocker locker(&m_lock);
+    m_utf16Buffer.Clear();
+    m_utf16Writer.Reset(m_utf16Buffer);
+    writeEvent(m_utf16Writer, event);
+    for (int i = 0; i < m_endOfLineLength; ++i)
+        m_utf16Buffer.Put(m_endOfLine[i]);
+
+    // Layout 接口要求返回 QString，UTF-16 缓冲区可直接整体复制
+    return QString(reinterpret_cast<const QChar *>(m_utf16Buffer.GetString()), int(m_utf16Buffer.GetLength()));
+}
+
+QByteArray JsonLayout::formatUtf8(const LoggingEvent &event)
+{
+    QMutexLocker locker(&m_lock);
+    m_utf8Buffer.Clear();
+    m_utf8Writer.Reset(m_utf8Buffer);
+    writeEvent(m_utf8Writer, event);
+    for (int i = 0; i < m_endOfLineLength; ++i)
+        m_utf8Buffer.Put(char(m_endOfLine[i]));
+    return QByteArray(m_utf8Buffer.GetString(), int(m_utf8Buffer.GetSize()));
+}
+
+template<typename Writer>
+void JsonLayout::writeEvent(Writer &writer, const LoggingEvent &event)
+{
+    writer.StartObject();
+
+    writeKey(writer, u"time", 4);
+    writer.String(timeText(event.timeStamp()), rapidjson::SizeType(kTimeLength));
+    writeKey(writer, u"level", 5);
+    writeString(writer, event.level().toString());
+    writeKey(writer, u"logger", 6);
+    writeString(writer, event.loggename());
+    writeKey(writer, u"thread", 6);
+    writeString(writer, event.threadName());
+
+    const QString ndc = event.ndc();
+    if (!ndc.isEmpty()) {
+        writeKey(writer, u"ndc", 3);
+        writeString(writer, ndc);
+    }
+
+    if (event.lineNumber() > 0) {
+        writeKey(writer, u"file", 4);
+        writeString(writer, event.fileName());
+        writeKey(writer, u"line", 4);
+        writer.Int(event.lineNumber());
+        writeKey(writer, u"function", 8);
+        writeString(writer, event.functionName());
+    }
+
+    // 按键名排序输出，同样的属性每次得到同样的文本；
+    // properties() 返回隐式共享的副本，只增加引用计数，键值对指针在其生存期内有效
+    const QHash<QString, QString> properties = event.properties();
+    m_properties.clear();
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        if (!it.key().startsWith(kInternalPrefix))
+            m_properties.emplace_back(&it.key(), &it.value());
+    }
+    if (!m_properties.empty()) {
+        std::sort(m_properties.begin(), m_properties.end(), [](const Property &a, const Property &b) {
+            return *a.first < *b.first;
+        });
+        writeKey(writer, u"mdc", 3);
+        writer.StartObject();
+        for (const Property &property : m_properties) {
+            writeKey(writer, *property.first);
+            writeString(writer, *property.second);
+        }
+        writer.EndObject();
+    }
+
+    writeKey(writer, u"message", 7);
+    writeString(writer, event.message());
+
+    writer.EndObject();
+}
+
+const char16_t *JsonLayout::timeText(qint64 timeStamp)
+{
+    const qint64 second = timeStamp >= 0 ? timeStamp / 1000 : -((-timeStamp + 999) / 1000);
+    if (second != m_cachedSecond) {
+        m_cachedSecond = second;
+        const QString text = QDateTime::fromMSecsSinceEpoch(second * 1000, Qt::UTC)
+                                 .toString(QStringLiteral("yyyy-MM-dd'T'hh:mm:ss"))
+                                 .leftJustified(kSecondLength, QLatin1Char(' '), true);
+        for (int i = 0; i < kSecondLength; ++i)
+            m_timeText[i] = char16_t(text.at(i).unicode());
+        m_timeText[kSecondLength] = u'.';
+        m_timeText[kTimeLength - 1] = u'Z';
+    }
+
+    const int millis = int(timeStamp - second * 1000);
+    m_timeText[kSecondLength + 1] = char16_t(u'0' + millis / 100);
+    m_timeText[kSecondLength + 2] = char16_t(u'0' + millis / 10 % 10);
+    m_timeText[kSecondLength + 3] = char16_t(u'0' + millis % 10);
+    return m_timeText;
+}
+} // namespace Log
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include "log4qt/layout.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <QByteArray>
+#include <QMutex>
+
+#include <climits>
+#include <utility>
+#include <vector>
+
+/*
+* JSON Lines 布局：
+*   每个事件输出一行 JSON，字段依次为：
+*     time（UTC，ISO 8601，精确到毫秒）、level、logger、thread、ndc（非空时）、
+*     file/line/function（有调用位置时）、mdc（MDC 与事件属性，非空时）、message
+*   mdc 按键名排序，以 log. 开头的内部属性（采样标记、限流汇总标记等）不输出
+*   字符串直接以 UTF-16 交给 rapidjson::Writer 转义写入复用的缓冲区，不构造中间 QString 或 QJsonObject；
+*   不成对的代理项替换为 U+FFFD，保证每行都是合法的 JSON
+*   时间按秒缓存，同一秒内只改写毫秒数字
+*   format() 按 Layout 接口返回 QString；直接写字节流的 Appender 可用 formatUtf8() 省去一次转码
+*
+*  log.conf 示例：
+*   log4j.appender.file.layout=Log::JsonLayout
+*
+*  输出示例：
+*   {"time":"2026-01-01T08:00:00.123Z","level":"INFO","logger":"FEMLogger","thread":"main","message":"started"}
+*/
+
+namespace Log {
+class JsonLayout : public Log4Qt::Layout
+{
+    Q_OBJECT
+
+public:
+    explicit JsonLayout(QObject *parent = nullptr);
+
+    QString contentType() const override;
+    QString format(const Log4Qt::LoggingEvent &event) override;
+
+    // 输出 UTF-8 编码的一行 JSON（含换行符）
+    QByteArray formatUtf8(const Log4Qt::LoggingEvent &event);
+
+private:
+    using Utf16 = rapidjson::UTF16<char16_t>;
+    using Utf16Buffer = rapidjson::GenericStringBuffer<Utf16>;
+    using Utf16Writer = rapidjson::Writer<Utf16Buffer, Utf16, Utf16>;
+    using Utf8Writer = rapidjson::Writer<rapidjson::StringBuffer, Utf16, rapidjson::UTF8<>>;
+    using Property = std::pair<const QString *, const QString *>;
+
+    template<typename Writer>
+    void writeEvent(Writer &writer, const Log4Qt::LoggingEvent &event);
+
+    // 返回 time 字段的文本（调用方需持有 m_lock）
+    const char16_t *timeText(qint64 timeStamp);
+
+    QMutex m_lock;
+
+    Utf16Buffer             m_utf16Buffer;
+    Utf16Writer             m_utf16Writer;
+    rapidjson::StringBuffer m_utf8Buffer;
+    Utf8Writer              m_utf8Writer;
+
+    // 排序输出属性时复用的缓冲区（调用方需持有 m_lock）
+    std::vector<Property> m_properties;
+
+    // yyyy-MM-ddThh:mm:ss.zzzZ
+    static constexpr int kTimeLength = 24;
+    qint64               m_cachedSecond = LLONG_MIN;
+    char16_t             m_timeText[kTimeLength + 1];
+    char16_t             m_endOfLine[3];
+    int                  m_endOfLineLength;
+};
+} // namespace Log
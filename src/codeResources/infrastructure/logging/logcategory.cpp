@@ -0,0 +1,75 @@
+﻿#include "logcategory.h"
+#include "loggercache.h"
+#include "loghelper.h"
+#include "log4qt/logger.h"
+#include "log4qt/logmanager.h"
+
+namespace Log {
+using namespace Log4Qt;
+
+std::atomic<LogCategory *> LogCategory::s_head{nullptr};
+std::atomic<quint64>       LogCategory::s_generation{0};
+std::atomic<quint64>       LogCategory::s_fingerprint{0};
+
+LogCategory::LogCategory(const char *name)
+    : m_name(name)
+    , m_logger(nullptr)
+    , m_threshold(kUnknown)
+    , m_next(s_head.load(std::memory_order_relaxed))
+{
+    while (!s_head.compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+Logger *LogCategory::logger() const
+{
+    // Hierarchy 中的 Logger 在进程内一直存在，解析一次即可
+    Logger *logger = m_logger.load(std::memory_order_acquire);
+    if (!logger) {
+        logger = LoggerCache::logger(QLatin1String(m_name));
+        m_logger.store(logger, std::memory_order_release);
+    }
+    return logger;
+}
+
+void LogCategory::invalidateAll()
+{
+    s_generation.fetch_add(1);
+    for (LogCategory *category = s_head.load(std::memory_order_acquire); category; category = category->m_next)
+        category->m_threshold.store(kUnknown, std::memory_order_relaxed);
+}
+
+bool LogCategory::repositoryChanged()
+{
+    // FNV-1a 风格混合 threshold 与每个 logger 的地址和级别，logger 增加或级别变化都会改变结果
+    quint64 fingerprint = 14695981039346656037ull;
+    auto    mix = [&fingerprint](quint64 value) {
+        fingerprint ^= value;
+        fingerprint *= 1099511628211ull;
+    };
+    mix(quint64(LogManager::threshold().toInt()));
+    const Logger *root = LogManager::rootLogger();
+    mix(quint64(quintptr(root)));
+    mix(quint64(root->level().toInt()));
+    const QList<Logger *> loggers = LogManager::loggers();
+    for (const Logger *logger : loggers) {
+        mix(quint64(quintptr(logger)));
+        mix(quint64(logger->level().toInt()));
+    }
+    return s_fingerprint.exchange(fingerprint) != fingerprint;
+}
+
+int LogCategory::refresh() const
+{
+    // 首次判定时确保配置文件已加载
+    LogHelper::instance();
+
+    const quint64 generation = s_generation.load();
+    const int     threshold = qMax(qMax(logger()->effectiveLevel().toInt(), LogManager::threshold().toInt()), 1);
+    m_threshold.store(threshold, std::memory_order_relaxed);
+
+    // 计算期间配置发生变化时丢弃结果，下次重新计算
+    if (s_generation.load() != generation)
+        m_threshold.store(kUnknown, std::memory_order_relaxed);
+    return threshold;
+}
+} // namespace Log
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include "log4qt/level.h"
+
+#include <atomic>
+
+namespace Log4Qt {
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 日志分类：
+*   每个分类对应一个 log4qt Logger，Logger 指针首次使用时解析一次并缓存
+*   生效级别（logger 的 effectiveLevel 与仓库 threshold 中较高者）缓存在原子变量中，
+*   级别判定只是一次 relaxed 读取；配置重新加载或运行时修改级别后由 invalidateAll() 统一失效
+*   log4qt 的 Logger/Hierarchy 不提供级别变化通知：经 LogHelper 的修改立即失效，
+*   直接调用 Logger::setLevel、LogManager::setThreshold 或 PropertyConfigurator::configure 时，
+*   由 LogHelper 在主线程事件循环中定时调用 repositoryChanged() 比对各 logger 级别，发现变化后失效（最多延迟一个检查周期）
+*   分类对象必须是静态存储期（由 LOG_CATEGORY 宏定义），注册后不会被移除
+*
+*  Example:
+*   // 头文件
+*   LOG_DECLARE_CATEGORY(lcNetwork)
+*   // 源文件
+*   LOG_CATEGORY(lcNetwork, "Network")
+*   // 使用
+*   LOGD(lcNetwork, "connect to %1:%2", host, port);
+*
+*  log.conf 中按 logger 名称单独调整级别：
+*   log4j.logger.Network=DEBUG
+*/
+
+#define LOG_DECLARE_CATEGORY(name) Log::LogCategory &name();
+
+#define LOG_CATEGORY(name, loggerName) \
+    Log::LogCategory &name() \
+    { \
+        static Log::LogCategory category(loggerName); \
+        return category; \
+    }
+
+// 日志宏内部的变量名按行号拼接，不会遮蔽调用处的同名变量；两层展开使 __LINE__ 先替换为行号
+#define LOG_CONCAT_IMPL(a, b) a##b
+#define LOG_CONCAT(a, b)      LOG_CONCAT_IMPL(a, b)
+
+namespace Log {
+class LogCategory
+{
+public:
+    explicit LogCategory(const char *name);
+
+    const char     *name() const { return m_name; }
+    Log4Qt::Logger *logger() const;
+
+    bool isEnabled(Log4Qt::Level level) const
+    {
+        int threshold = m_threshold.load(std::memory_order_relaxed);
+        if (Q_UNLIKELY(threshold == kUnknown))
+            threshold = refresh();
+        return level.toInt() >= threshold;
+    }
+
+    // 配置或级别变化后调用，所有分类在下次判定时重新计算生效级别
+    static void invalidateAll();
+
+    // 仓库 threshold 与各 logger 级别自上次调用以来是否变化（遍历全部 logger，只用于定时检查）
+    static bool repositoryChanged();
+
+private:
+    Q_DISABLE_COPY(LogCategory)
+
+    static constexpr int kUnknown = 0;
+
+    int refresh() const;
+
+    const char                           *m_name;
+    mutable std::atomic<Log4Qt::Logger *> m_logger;
+    mutable std::atomic<int>              m_threshold;
+    LogCategory                          *m_next;
+
+    static std::atomic<LogCategory *> s_head;
+    static std::atomic<quint64>       s_generation;
+    static std::atomic<quint64>       s_fingerprint;
+};
+} // namespace Log
@@ -0,0 +1,211 @@
+﻿#include "logcontext.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace Log {
+namespace {
+using Entry = std::pair<QString, QString>;
+using Entries = std::vector<Entry>;
+
+std::atomic<quint64> s_version{0};
+
+Entries::iterator lowerBound(Entries &entries, const QString &key)
+{
+    return std::lower_bound(entries.begin(), entries.end(), key, [](const Entry &entry, const QString &value) {
+        return entry.first < value;
+    });
+}
+
+Entries::const_iterator lowerBound(const Entries &entries, const QString &key)
+{
+    return std::lower_bound(entries.begin(), entries.end(), key, [](const Entry &entry, const QString &value) {
+        return entry.first < value;
+    });
+}
+} // namespace
+
+struct LogContext::Snapshot::Data
+{
+    quint64                 version;
+    Entries                 entries;
+    QStringList             ndc;
+    QHash<QString, QString> properties;
+};
+
+struct LogContext::State
+{
+    Entries     entries; // 按键排序
+    QStringList ndc;
+    Snapshot    snapshot;
+    bool        dirty = false; // 上下文在 snapshot 生成后被修改过
+};
+
+LogContext::State &LogContext::state()
+{
+    thread_local State instance;
+    return instance;
+}
+
+quint64 LogContext::Snapshot::version() const
+{
+    return d ? d->version : 0;
+}
+
+QString LogContext::Snapshot::value(const QString &key) const
+{
+    if (!d)
+        return QString();
+    const auto it = lowerBound(d->entries, key);
+    return it != d->entries.end() && it->first == key ? it->second : QString();
+}
+
+QString LogContext::Snapshot::ndc() const
+{
+    return d && !d->ndc.isEmpty() ? d->ndc.last() : QString();
+}
+
+QHash<QString, QString> LogContext::Snapshot::properties() const
+{
+    return d ? d->properties : QHash<QString, QString>();
+}
+
+LogContext::Scope::Scope(const QString &key, const QString &value)
+    : m_key(key)
+    , m_existed(LogContext::contains(key))
+{
+    if (m_existed)
+        m_previous = LogContext::get(key);
+    LogContext::put(key, value);
+}
+
+LogContext::Scope::~Scope()
+{
+    if (m_existed)
+        LogContext::put(m_key, m_previous);
+    else
+        LogContext::remove(m_key);
+}
+
+LogContext::Adopt::Adopt(const Snapshot &snapshot)
+    : m_previous(LogContext::capture())
+{
+    LogContext::adopt(snapshot);
+}
+
+LogContext::Adopt::~Adopt()
+{
+    LogContext::adopt(m_previous);
+}
+
+void LogContext::put(const QString &key, const QString &value)
+{
+    State     &s = state();
+    const auto it = lowerBound(s.entries, key);
+    if (it != s.entries.end() && it->first == key) {
+        if (it->second == value)
+            return;
+        it->second = value;
+    } else {
+        s.entries.emplace(it, key, value);
+    }
+    s.dirty = true;
+}
+
+void LogContext::remove(const QString &key)
+{
+    State     &s = state();
+    const auto it = lowerBound(s.entries, key);
+    if (it == s.entries.end() || it->first != key)
+        return;
+    s.entries.erase(it);
+    s.dirty = true;
+}
+
+QString LogContext::get(const QString &key)
+{
+    const State &s = state();
+    const auto   it = lowerBound(s.entries, key);
+    return it != s.entries.end() && it->first == key ? it->second : QString();
+}
+
+bool LogContext::contains(const QString &key)
+{
+    const State &s = state();
+    const auto   it = lowerBound(s.entries, key);
+    return it != s.entries.end() && it->first == key;
+}
+
+void LogContext::clear()
+{
+    State &s = state();
+    if (s.entries.empty() && s.ndc.isEmpty())
+        return;
+    s.entries.clear();
+    s.ndc.clear();
+    s.dirty = true;
+}
+
+void LogContext::push(const QString &ndc)
+{
+    State &s = state();
+    s.ndc.append(ndc);
+    s.dirty = true;
+}
+
+QString LogContext::pop()
+{
+    State &s = state();
+    if (s.ndc.isEmpty())
+        return QString();
+    s.dirty = true;
+    return s.ndc.takeLast();
+}
+
+QString LogContext::peek()
+{
+    const State &s = state();
+    return s.ndc.isEmpty() ? QString() : s.ndc.last();
+}
+
+LogContext::Snapshot LogContext::capture()
+{
+    State &s = state();
+    if (!s.dirty)
+        return s.snapshot;
+
+    s.dirty = false;
+    if (s.entries.empty() && s.ndc.isEmpty()) {
+        s.snapshot = Snapshot();
+        return s.snapshot;
+    }
+
+    auto data = std::make_shared<Snapshot::Data>();
+    data->version = s_version.fetch_add(1, std::memory_order_relaxed) + 1;
+    data->entries = s.entries;
+    data->ndc = s.ndc;
+    data->properties.reserve(int(s.entries.size()));
+    for (const Entry &entry : s.entries)
+        data->properties.insert(entry.first, entry.second);
+    s.snapshot.d = std::move(data);
+    return s.snapshot;
+}
+
+void LogContext::adopt(const Snapshot &snapshot)
+{
+    State &s = state();
+    if (snapshot.d) {
+        s.entries = snapshot.d->entries;
+        s.ndc = snapshot.d->ndc;
+    } else {
+        s.entries.clear();
+        s.ndc.clear();
+    }
+    s.snapshot = snapshot;
+    s.dirty = false;
+}
+} // namespace Log
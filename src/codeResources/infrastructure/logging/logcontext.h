@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <QHash>
+#include <QString>
+
+#include <memory>
+
+/*
+* 线程内日志上下文（替代 log4qt 的 MDC/NDC）：
+*   MDC 在每个事件中复制一份 QHash，put 时再按写时复制整体分离；
+*   本类在线程局部存储中维护按键排序的扁平数组和 NDC 栈，每次修改递增版本号，
+*   capture() 只在版本变化后才生成新的不可变快照，上下文不变时所有事件共享同一个快照（只增加引用计数）
+*   快照同时保存交给 LoggingEvent 的属性表，布局通过 event.property(key) 直接读取
+*   LOGINFO、LOGD 等宏产生的事件自动带上当前快照；仍在使用 log4qt MDC/NDC 的代码照常生效，同名键以本类为准
+*
+*  Example:
+*   Log::LogContext::Scope request("requestId", id);   // 离开作用域时恢复原值
+*   Log::LogContext::put("userId", user);
+*   LOGINFO("order %1 created", orderId);               // %X{requestId} 输出 id
+*
+*   // 把上下文带到线程池任务中
+*   const auto context = Log::LogContext::capture();
+*   QtConcurrent::run([context]() {
+*       Log::LogContext::Adopt adopt(context);
+*       LOGINFO("running in worker");
+*   });
+*/
+
+namespace Log {
+class LogContext
+{
+public:
+    // 不可变快照，可跨线程共享
+    class Snapshot
+    {
+    public:
+        Snapshot() = default;
+
+        bool    isEmpty() const { return !d; }
+        quint64 version() const;
+        QString value(const QString &key) const;
+        QString ndc() const;
+
+        // 交给 LoggingEvent 的属性表，生成快照时构建一次
+        QHash<QString, QString> properties() const;
+
+    private:
+        friend class LogContext;
+        struct Data;
+        std::shared_ptr<const Data> d;
+    };
+
+    // 作用域内设置一个键，析构时恢复原值
+    class Scope
+    {
+    public:
+        Scope(const QString &key, const QString &value);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+
+        QString m_key;
+        QString m_previous;
+        bool    m_existed;
+    };
+
+    // 作用域内使用另一个线程捕获的上下文，析构时恢复本线程原来的上下文
+    class Adopt
+    {
+    public:
+        explicit Adopt(const Snapshot &snapshot);
+        ~Adopt();
+
+    private:
+        Q_DISABLE_COPY(Adopt)
+
+        Snapshot m_previous;
+    };
+
+    static void    put(const QString &key, const QString &value);
+    static void    remove(const QString &key);
+    static QString get(const QString &key);
+    static bool    contains(const QString &key);
+    static void    clear();
+
+    static void    push(const QString &ndc);
+    static QString pop();
+    static QString peek();
+
+    // 当前线程上下文的快照，上下文未变化时返回同一个快照
+    static Snapshot capture();
+
+    // 用快照替换当前线程的上下文
+    static void adopt(const Snapshot &snapshot);
+
+private:
+    struct State;
+    static State &state();
+};
+} // namespace Log
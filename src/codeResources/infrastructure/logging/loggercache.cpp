@@ -0,0 +1,136 @@
+﻿#include "loggercache.h"
+#include "log4qt/logger.h"
+#include "log4qt/logmanager.h"
+
+#include <QHash>
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr size_t kInitialSize = 64;
+} // namespace
+
+struct LoggerCache::Entry
+{
+    QString name;
+    size_t  hash;
+    Logger *logger;
+};
+
+struct LoggerCache::Table
+{
+    explicit Table(size_t size)
+        : mask(size - 1)
+        , cells(new std::atomic<const Entry *>[size])
+    {
+        for (size_t i = 0; i < size; ++i)
+            cells[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    const size_t                                        mask;
+    const std::unique_ptr<std::atomic<const Entry *>[]> cells;
+};
+
+struct LoggerCache::Map
+{
+    std::atomic<Table *> current{nullptr};
+
+    // 以下由 lock 保护
+    QMutex                              lock;
+    std::vector<std::unique_ptr<Table>> tables; // 包括已被替换的旧表，读者可能仍在访问
+    std::vector<std::unique_ptr<Entry>> entries;
+};
+
+LoggerCache::Map &LoggerCache::map()
+{
+    static Map instance;
+    return instance;
+}
+
+Logger *LoggerCache::logger(const QString &name)
+{
+    Map         &m = map();
+    const size_t hash = qHash(name);
+    if (const Table *table = m.current.load(std::memory_order_acquire)) {
+        if (Logger *logger = find(table, name, hash))
+            return logger;
+    }
+
+    // 未命中：读者可能看到的是旧表，加锁后在当前表中再查一次
+    QMutexLocker locker(&m.lock);
+    Table       *table = m.current.load(std::memory_order_relaxed);
+    if (table) {
+        if (Logger *logger = find(table, name, hash))
+            return logger;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->name = name;
+    entry->hash = hash;
+    entry->logger = LogManager::logger(name);
+
+    // 装载因子保持在 1/2 以下，探测序列短且一定能遇到空槽
+    const size_t size = table ? table->mask + 1 : 0;
+    if ((m.entries.size() + 1) * 2 > size) {
+        auto grown = std::make_unique<Table>(size ? size * 2 : kInitialSize);
+        for (const auto &existing : m.entries)
+            insert(grown.get(), existing.get());
+        table = grown.get();
+        m.tables.push_back(std::move(grown));
+        insert(table, entry.get());
+        m.current.store(table, std::memory_order_release);
+    } else {
+        insert(table, entry.get());
+    }
+
+    Logger *logger = entry->logger;
+    m.entries.push_back(std::move(entry));
+    return logger;
+}
+
+Logger *LoggerCache::logger(const QObject *object)
+{
+    // 每个线程按 QMetaObject 缓存，命中时不构造类名字符串
+    thread_local QHash<const QMetaObject *, Logger *> cache;
+    const QMetaObject *meta = object->metaObject();
+    Logger           *&logger = cache[meta];
+    if (!logger)
+        logger = LoggerCache::logger(QLatin1String(meta->className()));
+    return logger;
+}
+
+int LoggerCache::count()
+{
+    Map         &m = map();
+    QMutexLocker locker(&m.lock);
+    return int(m.entries.size());
+}
+
+Logger *LoggerCache::find(const Table *table, const QString &name, size_t hash)
+{
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        const Entry *entry = table->cells[i].load(std::memory_order_acquire);
+        if (!entry)
+            return nullptr;
+        if (entry->hash == hash && entry->name == name)
+            return entry->logger;
+    }
+}
+
+void LoggerCache::insert(Table *table, const Entry *entry)
+{
+    size_t i = entry->hash & table->mask;
+    while (table->cells[i].load(std::memory_order_relaxed))
+        i = (i + 1) & table->mask;
+    // release 保证读者取得表项指针时表项内容已经完整
+    table->cells[i].store(entry, std::memory_order_release);
+}
+} // namespace Log
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <QString>
+
+#include <atomic>
+
+class QObject;
+
+namespace Log4Qt {
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 无锁 logger 查找：
+*   Logger::logger(name) 每次都经过 Hierarchy 的读写锁并对名称做一次 QHash 查找，
+*   按调用或按对象查找 logger 的代码在多线程下会在这把锁上竞争（Hierarchy 位于预编译的 log4qt 库中，无法直接修改）
+*   本类在其前面加一层只增不减的开放寻址哈希表：
+*     已有 logger 的查找只做原子读取和字符串比较，不加锁；未命中时加锁向 Hierarchy 取得 logger 并插入
+*     表项发布后不再修改；扩容时建立两倍大小的新表原子替换，旧表保留到进程结束
+*     （新旧表共享表项，保留的总大小不超过当前表的两倍）
+*   Hierarchy 中的 Logger 在进程内一直存在，缓存的指针不会失效
+*   LOG_DECLARE_QCLASS_LOGGER 可直接替换 log4qt 的 LOG4QT_DECLARE_QCLASS_LOGGER：
+*   ClassLogger 每个新对象首次调用 logger() 都要经过 Hierarchy 的锁，短生命周期对象多时竞争明显；
+*   本宏改为按类（QMetaObject）在线程内缓存，再经本类查找，logger 名称同样取对象的实际类名
+*
+*  Example:
+*   Log4Qt::Logger *logger = Log::LoggerCache::logger(QStringLiteral("Network"));
+*
+*   class Worker : public QObject
+*   {
+*       Q_OBJECT
+*       LOG_DECLARE_QCLASS_LOGGER
+*       ...
+*   };
+*   logger()->debug("started");
+*/
+
+#define LOG_DECLARE_QCLASS_LOGGER \
+private: \
+    mutable std::atomic<Log4Qt::Logger *> m_classLogger{nullptr}; \
+\
+public: \
+    Log4Qt::Logger *logger() const \
+    { \
+        Log4Qt::Logger *logger = m_classLogger.load(std::memory_order_relaxed); \
+        if (!logger) { \
+            logger = Log::LoggerCache::logger(this); \
+            m_classLogger.store(logger, std::memory_order_relaxed); \
+        } \
+        return logger; \
+    } \
+\
+private:
+
+namespace Log {
+class LoggerCache
+{
+public:
+    static Log4Qt::Logger *logger(const QString &name);
+    // 以对象的实际类名为名称的 logger，与 log4qt 的 ClassLogger 相同
+    static Log4Qt::Logger *logger(const QObject *object);
+
+    // 已缓存的 logger 数量
+    static int count();
+
+private:
+    struct Entry;
+    struct Table;
+    struct Map;
+
+    static Map &map();
+    static Log4Qt::Logger *find(const Table *table, const QString &name, size_t hash);
+    static void            insert(Table *table, const Entry *entry);
+};
+} // namespace Log
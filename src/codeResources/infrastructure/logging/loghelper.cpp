@@ -1,19 +1,160 @@
-﻿#include "LogHelper.h"
+﻿#include "loghelper.h"
+#include "appenderskeleton.h"
+#include "asyncrollingfileappender.h"
+#include "batchsignalappender.h"
+#include "fastpatternlayout.h"
+#include "flightrecorderappender.h"
+#include "groupcommitfileappender.h"
+#include "jsonlayout.h"
+#include "loggercache.h"
+#include "qtmessagebridge.h"
+#include "ratelimitfilter.h"
+#include "ringbufferappender.h"
+#include "logmanager.h"
 #include "propertyconfigurator.h"
+#include "helpers/configuratorhelper.h"
+#include "helpers/factory.h"
+#include "helpers/optionconverter.h"
+#include "helpers/properties.h"
+#ifdef QTRAPIDCORE_LOG_SQL
+#include "batchdatabaseappender.h"
+#endif
+#ifdef QTRAPIDCORE_LOG_NETWORK
+#include "logstreamserverappender.h"
+#endif
 
-#include <windows.h>
+#include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTimer>
 #include <QtCore/QCoreApplication>
 
+#include <functional>
+
 #define LOGCONFIG_PATH "./log.conf"
 #define LOGCONFIG_NAME "log.conf"
 
 namespace Log {
-QMutex     LogHelper::m_Mutex;
-LogHelper *LogHelper::m_Instance = nullptr;
+LOG_CATEGORY(femLoggerCategory, "FEMLogger")
+
+namespace {
+// 编辑器保存时通常连续触发多次变化通知，合并为一次重新加载
+constexpr int kReloadDelay = 500;
+// 直接调用 log4qt 接口修改级别时没有通知，按此周期比对仓库中的级别
+constexpr int kLevelCheckInterval = 1000;
+
+const QString kRootLoggerKey = QStringLiteral("log4j.rootLogger");
+const QString kThresholdKey = QStringLiteral("log4j.threshold");
+const QString kAdditivityPrefix = QStringLiteral("log4j.additivity.");
+const QString kLoggerPrefixes[] = {QStringLiteral("log4j.logger."), QStringLiteral("log4j.category.")};
+
+// logger 配置项的值：级别, Appender1, Appender2...
+struct LoggerEntry
+{
+    QString     level;
+    QStringList appenders;
+};
+
+LoggerEntry parseLoggerEntry(const QString &value)
+{
+    LoggerEntry       entry;
+    const QStringList parts = value.split(QLatin1Char(','));
+    entry.level = parts.first().trimmed();
+    for (int i = 1; i < parts.size(); ++i) {
+        const QString appender = parts.at(i).trimmed();
+        if (!appender.isEmpty())
+            entry.appenders.append(appender);
+    }
+    return entry;
+}
+
+// 判断是否为 logger 配置项，是则返回 logger 名称（根 logger 为空字符串）
+bool isLoggerKey(const QString &key, QString *loggerName)
+{
+    if (key == kRootLoggerKey) {
+        loggerName->clear();
+        return true;
+    }
+    for (const QString &prefix : kLoggerPrefixes) {
+        if (key.startsWith(prefix) && key.size() > prefix.size()) {
+            *loggerName = key.mid(prefix.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+QString loggerValue(const Properties &properties, const QString &loggerName)
+{
+    if (loggerName.isEmpty())
+        return properties.property(kRootLoggerKey);
+    for (const QString &prefix : kLoggerPrefixes) {
+        if (properties.contains(prefix + loggerName))
+            return properties.property(prefix + loggerName);
+    }
+    return QString();
+}
+
+// 非根 logger 未配置级别时继承父级
+bool toLoggerLevel(const QString &text, bool root, Level *level)
+{
+    if (!root
+        && (text.isEmpty() || text.compare(QLatin1String("INHERITED"), Qt::CaseInsensitive) == 0
+            || text.compare(QLatin1String("NULL"), Qt::CaseInsensitive) == 0)) {
+        *level = Level(Level::NULL_INT);
+        return true;
+    }
+    bool ok = false;
+    *level = Level::fromString(text, &ok);
+    return ok;
+}
+
+// 对象的 LiveOptions（各类用 Q_CLASSINFO 声明，逐级合并）或 threshold 可在运行时修改，无需重新激活
+bool isLiveOption(const QObject *object, const QString &property)
+{
+    if (property.compare(QLatin1String("threshold"), Qt::CaseInsensitive) == 0)
+        return true;
+    const QMetaObject *meta = object->metaObject();
+    for (int i = 0; i < meta->classInfoCount(); ++i) {
+        const QMetaClassInfo info = meta->classInfo(i);
+        if (qstrcmp(info.name(), "LiveOptions") != 0)
+            continue;
+        const QStringList options = QString::fromLatin1(info.value()).split(QLatin1Char(','));
+        for (const QString &option : options) {
+            if (option.compare(property, Qt::CaseInsensitive) == 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+Logger *loggerByName(const QString &loggerName)
+{
+    return loggerName.isEmpty() ? LogManager::rootLogger() : LoggerCache::logger(loggerName);
+}
+} // namespace
+
 LogHelper::LogHelper()
     : m_LogAll(nullptr)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_reloadTimer(new QTimer(this))
+    , m_levelTimer(new QTimer(this))
 {
+    // 首次写日志的可能是工作线程，文件监视与防抖定时器放到主线程的事件循环中
+    if (QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(kReloadDelay);
+    m_levelTimer->setInterval(kLevelCheckInterval);
+    connect(m_levelTimer, &QTimer::timeout, this, []() {
+        if (LogCategory::repositoryChanged())
+            levelsChanged();
+    });
+
     initLogConfig();
     //    m_LogInfo = Logger::logger("info");
     //    m_LogDebug = Logger::logger("debug");
@@ -24,7 +165,8 @@ LogHelper::LogHelper()
 
 void LogHelper::initLogConfig()
 {
-    SetCurrentDirectory(QCoreApplication::applicationDirPath().toStdString().c_str());
+    // 相对路径（log.conf 与其中的日志文件）以程序所在目录为准
+    QDir::setCurrent(QCoreApplication::applicationDirPath());
 
     QString   confPath = "";
     QFileInfo f(LOGCONFIG_PATH);
@@ -33,6 +175,388 @@ void LogHelper::initLogConfig()
     else
         confPath = QCoreApplication::applicationDirPath() + "/" + LOGCONFIG_NAME;
 
+    registerExtensions();
+    m_confPath = confPath;
+    m_properties = loadProperties(confPath);
     Log4Qt::PropertyConfigurator::configure(confPath);
+    configureFilters(m_properties);
+    LogCategory::repositoryChanged();
+    LogCategory::invalidateAll();
+
+    // log4qt 监视配置文件并重新加载后，分类缓存的级别随之失效
+    connect(ConfiguratorHelper::instance(), &ConfiguratorHelper::configurationFileChanged, this, []() { levelsChanged(); });
+
+    if (QCoreApplication::instance()) {
+        // 构造可能发生在工作线程，文件监视与定时器须在所属的主线程中设置和启动
+        QMetaObject::invokeMethod(this, [this]() { watchConfig(); }, Qt::QueuedConnection);
+        QMetaObject::invokeMethod(m_levelTimer, "start", Qt::QueuedConnection);
+    }
+}
+
+LogCategory &LogHelper::defaultCategory()
+{
+    return femLoggerCategory();
+}
+
+void LogHelper::registerExtensions()
+{
+    Factory::registerAppender("Log::GroupCommitFileAppender",
+                              []() -> Appender * { return new GroupCommitFileAppender; });
+    Factory::registerAppender("Log::AsyncRollingFileAppender",
+                              []() -> Appender * { return new AsyncRollingFileAppender; });
+    Factory::registerAppender("Log::BatchSignalAppender",
+                              []() -> Appender * { return new BatchSignalAppender; });
+    Factory::registerAppender("Log::FlightRecorderAppender",
+                              []() -> Appender * { return new FlightRecorderAppender; });
+#ifdef QTRAPIDCORE_LOG_SQL
+    Factory::registerAppender("Log::BatchDatabaseAppender",
+                              []() -> Appender * { return new BatchDatabaseAppender; });
+#endif
+#ifdef QTRAPIDCORE_LOG_NETWORK
+    Factory::registerAppender("Log::LogStreamServerAppender",
+                              []() -> Appender * { return new LogStreamServerAppender; });
+#endif
+    Factory::registerAppender("Log::RingBufferAppender", []() -> Appender * { return new RingBufferAppender; });
+    Factory::registerFilter("Log::RateLimitFilter", []() -> Filter * { return new RateLimitFilter; });
+    Factory::registerFilter("Log::SamplingFilter", []() -> Filter * { return new SamplingFilter; });
+    Factory::registerLayout("Log::FastPatternLayout", []() -> Layout * { return new FastPatternLayout; });
+    Factory::registerLayout("Log::JsonLayout", []() -> Layout * { return new JsonLayout; });
+}
+
+void LogHelper::setLevel(const QString &loggerName, Level level)
+{
+    LogHelper   *helper = instance();
+    QMutexLocker locker(&helper->m_configLock);
+    loggerByName(loggerName)->setLevel(level);
+    levelsChanged();
+}
+
+Level LogHelper::level(const QString &loggerName)
+{
+    instance();
+    return loggerByName(loggerName)->effectiveLevel();
+}
+
+void LogHelper::resetLevel(const QString &loggerName)
+{
+    LogHelper   *helper = instance();
+    QMutexLocker locker(&helper->m_configLock);
+    Level        level;
+    if (!toLoggerLevel(parseLoggerEntry(loggerValue(helper->m_properties, loggerName)).level,
+                       loggerName.isEmpty(),
+                       &level))
+        return;
+    loggerByName(loggerName)->setLevel(level);
+    levelsChanged();
+}
+
+void LogHelper::reloadConfig()
+{
+    instance()->reload();
+}
+
+void LogHelper::installQtMessageHandler()
+{
+    // 先加载配置，过滤器按 log.conf 中的级别计算分类开关
+    instance();
+    QtMessageBridge::install();
+}
+
+void LogHelper::removeQtMessageHandler()
+{
+    QtMessageBridge::uninstall();
+}
+
+void LogHelper::levelsChanged()
+{
+    LogCategory::invalidateAll();
+    QtMessageBridge::refresh();
+}
+
+void LogHelper::watchConfig()
+{
+    // 同时监视所在目录：以“写临时文件再改名”方式保存的编辑器会使文件监视失效
+    // 目录中其他文件的增删也会触发，但内容未变时重新加载直接返回
+    m_watcher->addPath(QFileInfo(m_confPath).absolutePath());
+    if (QFileInfo::exists(m_confPath))
+        m_watcher->addPath(m_confPath);
+
+    auto schedule = [this]() { m_reloadTimer->start(); };
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, schedule);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, schedule);
+    connect(m_reloadTimer, &QTimer::timeout, this, [this]() {
+        if (QFileInfo::exists(m_confPath) && !m_watcher->files().contains(m_confPath))
+            m_watcher->addPath(m_confPath);
+        reload();
+    });
+}
+
+void LogHelper::reload()
+{
+    QMutexLocker locker(&m_configLock);
+
+    // 保存过程中可能读到空文件，等待下一次变化通知
+    const Properties next = loadProperties(m_confPath);
+    if (next.isEmpty() || next == m_properties)
+        return;
+
+    if (!applyIncremental(next)) {
+        // 结构变化时重建全部 Appender，运行时调整的级别随之失效
+        LogManager::resetConfiguration();
+        PropertyConfigurator::configure(next);
+        configureFilters(next);
+    }
+    m_properties = next;
+    levelsChanged();
+    SamplingFilter::invalidateCoverage();
+}
+
+bool LogHelper::applyIncremental(const Properties &next)
+{
+    static const QRegularExpression filterOption(
+        QStringLiteral("^(log4j\\.appender\\.[^.]+\\.filter\\.[^.]+)\\.(.+)$"));
+    static const QRegularExpression layoutOption(QStringLiteral("^log4j\\.appender\\.([^.]+)\\.layout\\.(.+)$"));
+    static const QRegularExpression appenderOption(QStringLiteral("^log4j\\.appender\\.([^.]+)\\.([^.]+)$"));
+    static const QRegularExpression appenderKey(QStringLiteral("^log4j\\.appender\\.([^.]+)"));
+
+    QSet<QString> keys;
+    for (auto it = m_properties.constBegin(); it != m_properties.constEnd(); ++it)
+        keys.insert(it.key());
+    for (auto it = next.constBegin(); it != next.constEnd(); ++it)
+        keys.insert(it.key());
+
+    // 先校验全部变化再统一应用，不会出现只应用了一部分的情况
+    QVector<std::function<void()>>    actions;
+    QSet<QObject *>                   appenders;
+    QSet<Layout *>                    layouts;
+    QSet<Filter *>                    filters;
+    QHash<QString, AppenderSharedPtr> created;    // 本次新建的 Appender，其配置项已在创建时使用
+    QSet<QString>                     referenced; // next 中仍被 logger 引用的 Appender
+
+    // 第一遍处理 logger 配置项：新引用的 Appender 在这里创建，第二遍才能跳过它们的配置项
+    for (const QString &key : qAsConst(keys)) {
+        QString loggerName;
+        if (!isLoggerKey(key, &loggerName))
+            continue;
+        const LoggerEntry after = parseLoggerEntry(next.property(key));
+        for (const QString &name : after.appenders)
+            referenced.insert(name);
+        if (m_properties.contains(key) == next.contains(key) && m_properties.property(key) == next.property(key))
+            continue;
+
+        const LoggerEntry before = parseLoggerEntry(m_properties.property(key));
+        Level             level;
+        if (!toLoggerLevel(after.level, loggerName.isEmpty(), &level))
+            return false;
+        Logger *logger = loggerByName(loggerName);
+        actions.append([logger, level]() { logger->setLevel(level); });
+        if (before.appenders == after.appenders)
+            continue;
+
+        // 挂载列表变化时只摘除/挂载差异部分，未变化的 Appender 保持打开
+        QVector<AppenderSharedPtr> attach;
+        QStringList                detach;
+        for (const QString &name : after.appenders) {
+            if (before.appenders.contains(name))
+                continue;
+            AppenderSharedPtr appender = created.value(name);
+            if (!appender)
+                appender = findAppender(name);
+            if (!appender) {
+                appender = createAppender(next, name);
+                if (!appender)
+                    return false;
+                created.insert(name, appender);
+            }
+            attach.append(appender);
+        }
+        for (const QString &name : before.appenders) {
+            if (!after.appenders.contains(name))
+                detach.append(name);
+        }
+        actions.append([logger, attach, detach]() {
+            for (const QString &name : detach)
+                logger->removeAppender(name);
+            for (const AppenderSharedPtr &appender : attach)
+                logger->addAppender(appender);
+        });
+    }
+
+    for (const QString &key : qAsConst(keys)) {
+        const bool    existed = m_properties.contains(key);
+        const bool    exists = next.contains(key);
+        const QString value = next.property(key);
+        QString       loggerName;
+        if ((existed == exists && m_properties.property(key) == value) || isLoggerKey(key, &loggerName))
+            continue;
+
+        if (key.startsWith(kAdditivityPrefix)) {
+            Logger    *logger = LogManager::logger(key.mid(kAdditivityPrefix.size()));
+            const bool additivity = OptionConverter::toBoolean(value, true);
+            actions.append([logger, additivity]() { logger->setAdditivity(additivity); });
+            continue;
+        }
+        if (key == kThresholdKey) {
+            const Level threshold = OptionConverter::toLevel(value, Level(Level::ALL_INT));
+            actions.append([threshold]() { LogManager::setThreshold(threshold); });
+            continue;
+        }
+
+        // 新建 Appender 的配置项已在创建时应用；不再被任何 logger 引用的 Appender 的配置项不起作用
+        const QString appenderName = appenderKey.match(key).captured(1);
+        if (!appenderName.isEmpty() && (created.contains(appenderName) || !referenced.contains(appenderName)))
+            continue;
+
+        // 其余只接受已有对象的属性修改，删除属性无法恢复默认值
+        if (!exists)
+            return false;
+
+        QRegularExpressionMatch match = filterOption.match(key);
+        if (match.hasMatch()) {
+            const FilterSharedPtr filter = m_filters.value(match.captured(1));
+            if (!filter || next.property(match.captured(1)) != m_properties.property(match.captured(1)))
+                return false;
+            const QString property = match.captured(2);
+            actions.append([filter, property, value]() { Factory::setObjectProperty(filter.data(), property, value); });
+            filters.insert(filter.data());
+            continue;
+        }
+        match = layoutOption.match(key);
+        if (match.hasMatch()) {
+            const AppenderSharedPtr appender = findAppender(match.captured(1));
+            const LayoutSharedPtr   layout = appender ? appender->layout() : LayoutSharedPtr();
+            if (!layout)
+                return false;
+            const QString property = match.captured(2);
+            actions.append([layout, property, value]() { Factory::setObjectProperty(layout.data(), property, value); });
+            layouts.insert(layout.data());
+            continue;
+        }
+        match = appenderOption.match(key);
+        if (match.hasMatch() && match.captured(2).compare(QLatin1String("layout"), Qt::CaseInsensitive) != 0) {
+            // 文件名、appendFile 等需要重新打开才能生效的属性不在 LiveOptions 中，按结构变化处理
+            const AppenderSharedPtr appender = findAppender(match.captured(1));
+            const QString           property = match.captured(2);
+            if (!appender || !isLiveOption(appender.data(), property))
+                return false;
+            actions.append([appender, property, value]() { Factory::setObjectProperty(appender.data(), property, value); });
+            appenders.insert(appender.data());
+            continue;
+        }
+        return false;
+    }
+
+    // 新建的 Appender 先挂好过滤器再挂载到 logger，挂载后的第一条事件也经过过滤
+    for (const AppenderSharedPtr &appender : qAsConst(created))
+        configureFilters(next, appender);
+    for (const auto &action : qAsConst(actions))
+        action();
+    // 已有 Appender 不重新激活（FileAppender 重新激活会重新打开文件），只通知其应用 LiveOptions
+    for (Layout *layout : qAsConst(layouts))
+        layout->activateOptions();
+    for (Filter *filter : qAsConst(filters))
+        filter->activateOptions();
+    for (QObject *appender : qAsConst(appenders)) {
+        if (appender->metaObject()->indexOfMethod("applyOptions()") >= 0)
+            QMetaObject::invokeMethod(appender, "applyOptions", Qt::DirectConnection);
+    }
+    return true;
+}
+
+AppenderSharedPtr LogHelper::createAppender(const Properties &properties, const QString &name)
+{
+    // 与 PropertyConfigurator 的写法相同：log4j.appender.<名称>=类名，.layout=Layout 类名，其余为属性
+    const QString prefix = QStringLiteral("log4j.appender.") + name;
+    Appender     *raw = Factory::createAppender(properties.property(prefix));
+    if (!raw)
+        return AppenderSharedPtr();
+    const AppenderSharedPtr appender(raw);
+    appender->setName(name);
+
+    const QString layoutPrefix = prefix + QStringLiteral(".layout");
+    if (properties.contains(layoutPrefix)) {
+        Layout *layout = Factory::createLayout(properties.property(layoutPrefix));
+        if (!layout)
+            return AppenderSharedPtr();
+        const LayoutSharedPtr shared(layout);
+        for (const QString &option : properties.propertyNames()) {
+            if (option.startsWith(layoutPrefix + QLatin1Char('.')))
+                Factory::setObjectProperty(layout, option.mid(layoutPrefix.size() + 1), properties.property(option));
+        }
+        layout->activateOptions();
+        appender->setLayout(shared);
+    } else if (appender->requiresLayout()) {
+        return AppenderSharedPtr();
+    }
+
+    static const QRegularExpression ownOption(QStringLiteral("^[^.]+$"));
+    for (const QString &option : properties.propertyNames()) {
+        if (!option.startsWith(prefix + QLatin1Char('.')))
+            continue;
+        const QString property = option.mid(prefix.size() + 1);
+        if (ownOption.match(property).hasMatch() && property.compare(QLatin1String("layout"), Qt::CaseInsensitive) != 0)
+            Factory::setObjectProperty(appender.data(), property, properties.property(option));
+    }
+    if (auto *skeleton = qobject_cast<AppenderSkeleton *>(raw))
+        skeleton->activateOptions();
+    return appender;
+}
+
+Properties LogHelper::loadProperties(const QString &confPath)
+{
+    Properties properties;
+    QFile      file(confPath);
+    if (file.open(QIODevice::ReadOnly))
+        properties.load(&file);
+    return properties;
+}
+
+void LogHelper::configureFilters(const Properties &properties, const AppenderSharedPtr &target)
+{
+    if (!target)
+        m_filters.clear();
+
+    // log4j.appender.<Appender>.filter.<ID>=<Filter类名>，同一 Appender 上按 ID 排序
+    static const QRegularExpression filterKey(QStringLiteral("^log4j\\.appender\\.([^.]+)\\.filter\\.([^.]+)$"));
+    QStringList filterKeys = properties.propertyNames().filter(filterKey);
+    filterKeys.sort();
+
+    for (const QString &key : qAsConst(filterKeys)) {
+        const QString name = filterKey.match(key).captured(1);
+        if (target && name != target->name())
+            continue;
+        // 指定的 Appender 可能尚未挂载到 logger，按名称查找不到
+        const AppenderSharedPtr appender = target ? target : findAppender(name);
+        if (!appender)
+            continue;
+        Filter *filter = Factory::createFilter(properties.property(key));
+        if (!filter)
+            continue;
+
+        const QString prefix = key + QLatin1Char('.');
+        for (const QString &option : properties.propertyNames()) {
+            if (option.startsWith(prefix))
+                Factory::setObjectProperty(filter, option.mid(prefix.size()), properties.property(option));
+        }
+        if (auto *rateLimit = qobject_cast<RateLimitFilter *>(filter))
+            rateLimit->setAppender(appender.data());
+        filter->activateOptions();
+        const FilterSharedPtr shared(filter);
+        appender->addFilter(shared);
+        m_filters.insert(key, shared);
+    }
+    SamplingFilter::invalidateCoverage();
+}
+
+AppenderSharedPtr LogHelper::findAppender(const QString &name)
+{
+    if (AppenderSharedPtr appender = LogManager::rootLogger()->appender(name))
+        return appender;
+    const auto loggers = LogManager::loggers();
+    for (Logger *logger : loggers) {
+        if (AppenderSharedPtr appender = logger->appender(name))
+            return appender;
+    }
+    return AppenderSharedPtr();
 }
 } // namespace Log
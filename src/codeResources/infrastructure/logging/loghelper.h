@@ -1,9 +1,20 @@
 ﻿#pragma once
 
+#include "fastlogstream.h"
+#include "logcategory.h"
+#include "logmetrics.h"
+#include "messageformatter.h"
+#include "pooledevent.h"
+#include "samplingfilter.h"
 #include "log4qt/logger.h"
+#include "log4qt/helpers/properties.h"
 
+#include <QHash>
 #include <QMutex>
 
+class QFileSystemWatcher;
+class QTimer;
+
 /*
 * 日志宏：
 *   提供简单的日志处理
@@ -12,13 +23,30 @@
 *   基础宏暂时不支持输出类名、函数名、代码行号
 *   扩展宏支持输出函数名和代码行号，但会影响性能
 *   Release版本使用基础宏，Debug版本使用扩展宏
+*   分类宏：LOGT、LOGD、LOGI、LOGW、LOGE、LOGF，第一个参数为 LOG_CATEGORY 定义的分类（见 logcategory.h），
+*   每个分类对应独立的 logger，可在 log.conf 中单独调整级别；级别未开启时不求值参数
+*   流式宏：LOGST、LOGSD、LOGSI、LOGSW、LOGSE、LOGSF，用法为 LOGSD(lcNetwork) << ...（见 fastlogstream.h）
 *
 *   底层使用的是QString类型字符串，所以上层的字符串格式化采用的是%1
+*   格式化为单遍替换（见 messageformatter.h），占位符编号规则与 QString::arg 链式调用相同，
+*   但参数值中的 %n 不会被再次替换，也不支持 arg() 的 fieldWidth/进制等附加参数
+*   消息为字符串字面量或 QByteArray 时按 UTF-8 直接格式化到事件缓冲区，级别判定之前不构造临时 QString，
+*   整条日志只在写出时由 Appender 编码一次（Debug 版本的扩展宏需要拼接位置信息，仍先转换为 QString）
+*
+*   log.conf 修改后自动重新加载（防抖 500ms），只调整变化的 logger 级别、Appender/Layout/Filter 属性，
+*   不重新激活已有 Appender（只应用各类 LiveOptions 声明的属性）；logger 挂载列表变化时只新建并挂载新增的 Appender、
+*   摘除移除的 Appender；修改文件名等需要重新打开的属性、类名或过滤器列表时才完整重新配置
+*   运行时可用 setLevel/resetLevel 临时调整级别，该 logger 在 log.conf 中的配置变化前一直有效
+*   绕过 LogHelper 直接修改 log4qt 级别时，分类缓存在 1 秒内的定时检查中失效（见 logcategory.h）
+*   installQtMessageHandler() 把 qDebug/qWarning 等 Qt 消息转入日志，按 logger "Qt" 控制级别（见 qtmessagebridge.h）
+*   各 logger 的输出/过滤计数与 Appender 的丢弃数、写入字节数由 LogMetrics 统计（见 logmetrics.h）
 *
 *  Example:（注意CMakeLists.txt要添加log4qt和LogHelper两个库）
 *   LOGINFO("test")
 *   LOGDEBUG("count %1", vec.count())
 *   LOGDEBUG("test name: %1, len: %2", "name", 4)
+*   LOGD(lcNetwork, "connect to %1:%2", host, port)
+*   Log::LogHelper::setLevel("Network", Log4Qt::Level::TRACE_INT);   // 排查完毕后 resetLevel("Network")
 */
 
 #ifdef QT_NO_DEBUG
@@ -26,6 +54,12 @@
 #define LOGDEBUG(...) Log::LogHelper::debug(__VA_ARGS__)
 #define LOGWARN(...)  Log::LogHelper::warn(__VA_ARGS__)
 #define LOGERROR(...) Log::LogHelper::error(__VA_ARGS__)
+
+#define LOG_CATEGORY_WRITE(category, level, ...) \
+    for (bool LOG_CONCAT(log_category_enabled_, __LINE__) = category().isEnabled(Log4Qt::Level::level); \
+         LOG_CONCAT(log_category_enabled_, __LINE__); \
+         LOG_CONCAT(log_category_enabled_, __LINE__) = false) \
+    Log::LogHelper::log(category(), Log4Qt::Level::level, __VA_ARGS__)
 #else
 
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
@@ -46,8 +80,25 @@
     Log::LogHelper::error(QString(message).append( \
                               QString("  [%1:%2(%3)]").arg(__FILENAME__).arg(__func__).arg(__LINE__)), \
                           ##__VA_ARGS__)
+
+#define LOG_CATEGORY_WRITE(category, level, message, ...) \
+    for (bool LOG_CONCAT(log_category_enabled_, __LINE__) = category().isEnabled(Log4Qt::Level::level); \
+         LOG_CONCAT(log_category_enabled_, __LINE__); \
+         LOG_CONCAT(log_category_enabled_, __LINE__) = false) \
+    Log::LogHelper::log(category(), \
+                        Log4Qt::Level::level, \
+                        QString(message).append( \
+                            QString("  [%1:%2(%3)]").arg(__FILENAME__).arg(__func__).arg(__LINE__)), \
+                        ##__VA_ARGS__)
 #endif
 
+#define LOGT(category, ...) LOG_CATEGORY_WRITE(category, TRACE_INT, __VA_ARGS__)
+#define LOGD(category, ...) LOG_CATEGORY_WRITE(category, DEBUG_INT, __VA_ARGS__)
+#define LOGI(category, ...) LOG_CATEGORY_WRITE(category, INFO_INT, __VA_ARGS__)
+#define LOGW(category, ...) LOG_CATEGORY_WRITE(category, WARN_INT, __VA_ARGS__)
+#define LOGE(category, ...) LOG_CATEGORY_WRITE(category, ERROR_INT, __VA_ARGS__)
+#define LOGF(category, ...) LOG_CATEGORY_WRITE(category, FATAL_INT, __VA_ARGS__)
+
 namespace Log {
 using namespace Log4Qt;
 class LogHelper : public QObject
@@ -55,51 +106,156 @@ class LogHelper : public QObject
 public:
     static LogHelper *instance()
     {
-        if (!m_Instance) {
-            m_Mutex.lock();
-            if (!m_Instance)
-                m_Instance = new LogHelper();
-            m_Mutex.unlock();
-        }
-        return m_Instance;
+        // 局部静态变量的初始化由编译器保证线程安全
+        static LogHelper *helper = new LogHelper();
+        return helper;
     }
 
-    static void info(const QString &msg) { instance()->m_LogAll->info(msg); }
+    static void info(const QString &msg) { write(Level::INFO_INT, msg); }
     template<typename T, typename... Ts>
     static void info(const QString &message, T &&t, Ts &&...ts)
     {
-        instance()->m_LogAll->info(message.arg(std::forward<T>(t)), std::forward<Ts>(ts)...);
+        write(Level::INFO_INT, message, std::forward<T>(t), std::forward<Ts>(ts)...);
+    }
+    template<typename Text, typename... Ts>
+    static std::enable_if_t<Detail::isUtf8Text<Text>> info(const Text &message, const Ts &...ts)
+    {
+        write(Level::INFO_INT, utf8View(message), ts...);
     }
 
-    static void debug(const QString &msg) { instance()->m_LogAll->debug(msg); }
+    static void debug(const QString &msg) { write(Level::DEBUG_INT, msg); }
     template<typename T, typename... Ts>
     static void debug(const QString &message, T &&t, Ts &&...ts)
     {
-        instance()->m_LogAll->debug(message.arg(std::forward<T>(t)), std::forward<Ts>(ts)...);
+        write(Level::DEBUG_INT, message, std::forward<T>(t), std::forward<Ts>(ts)...);
+    }
+    template<typename Text, typename... Ts>
+    static std::enable_if_t<Detail::isUtf8Text<Text>> debug(const Text &message, const Ts &...ts)
+    {
+        write(Level::DEBUG_INT, utf8View(message), ts...);
     }
 
-    static void warn(const QString &msg) { instance()->m_LogAll->warn(msg); }
+    static void warn(const QString &msg) { write(Level::WARN_INT, msg); }
     template<typename T, typename... Ts>
     static void warn(const QString &message, T &&t, Ts &&...ts)
     {
-        instance()->m_LogAll->warn(message.arg(std::forward<T>(t)), std::forward<Ts>(ts)...);
+        write(Level::WARN_INT, message, std::forward<T>(t), std::forward<Ts>(ts)...);
+    }
+    template<typename Text, typename... Ts>
+    static std::enable_if_t<Detail::isUtf8Text<Text>> warn(const Text &message, const Ts &...ts)
+    {
+        write(Level::WARN_INT, utf8View(message), ts...);
     }
 
-    static void error(const QString &msg) { instance()->m_LogAll->error(msg); }
+    static void error(const QString &msg) { write(Level::ERROR_INT, msg); }
     template<typename T, typename... Ts>
     static void error(const QString &message, T &&t, Ts &&...ts)
     {
-        instance()->m_LogAll->error(message.arg(std::forward<T>(t)), std::forward<Ts>(ts)...);
+        write(Level::ERROR_INT, message, std::forward<T>(t), std::forward<Ts>(ts)...);
+    }
+    template<typename Text, typename... Ts>
+    static std::enable_if_t<Detail::isUtf8Text<Text>> error(const Text &message, const Ts &...ts)
+    {
+        write(Level::ERROR_INT, utf8View(message), ts...);
+    }
+
+    // 分类日志入口，级别已由 LOGD 等宏通过 LogCategory 判定
+    template<typename... Ts>
+    static void log(const LogCategory &category, Level level, const QString &message, const Ts &...ts)
+    {
+        submit(category.logger(), level, message, ts...);
+    }
+    template<typename Text, typename... Ts>
+    static std::enable_if_t<Detail::isUtf8Text<Text>>
+    log(const LogCategory &category, Level level, const Text &message, const Ts &...ts)
+    {
+        submit(category.logger(), level, utf8View(message), ts...);
     }
 
+    // 运行时调整级别，loggerName 为空表示根 logger
+    static void  setLevel(const QString &loggerName, Level level);
+    static Level level(const QString &loggerName);
+    // 恢复为 log.conf 中的级别
+    static void resetLevel(const QString &loggerName);
+    // 立即重新加载 log.conf，通常由文件监视自动触发
+    static void reloadConfig();
+
+    // 接管 Qt 消息输出（默认不接管），QCoreApplication 析构时自动恢复
+    static void installQtMessageHandler();
+    static void removeQtMessageHandler();
+
 private:
     LogHelper();
 
+    // 级别与采样判定都在格式化消息之前完成，被丢弃的日志不产生格式化开销
+    // 消息单遍格式化到线程内复用的缓冲区，见 PooledEvent
+    template<typename Text, typename... Ts>
+    static void write(Level level, const Text &message, const Ts &...ts)
+    {
+        const LogCategory &category = defaultCategory();
+        if (category.isEnabled(level))
+            submit(category.logger(), level, message, ts...);
+    }
+
+    // Text 为 QString 或 Utf8View
+    template<typename Text, typename... Ts>
+    static void submit(Logger *logger, Level level, const Text &message, const Ts &...ts)
+    {
+        QString mark;
+        if (SamplingFilter::preSample(logger, level, &mark) == SamplingFilter::Discard) {
+            LogMetrics::countFiltered(logger);
+            return;
+        }
+
+        PooledEvent event;
+        if constexpr (sizeof...(Ts) == 0 && std::is_same_v<Text, QString>)
+            event.setMessage(message);
+        else if constexpr (sizeof...(Ts) == 0)
+            Detail::appendUtf8(event.message(), message.data, message.size);
+        else
+            formatMessage(event.message(), message, ts...);
+        if (!mark.isEmpty())
+            event.setProperty(SamplingFilter::markProperty(), mark);
+        event.dispatch(logger, level);
+    }
+
     void initLogConfig();
 
+    // LOGINFO 等基础宏使用的分类，对应 FEMLogger
+    static LogCategory &defaultCategory();
+
+    // 注册本目录下扩展的 Appender/Layout/Filter，使 log.conf 可以按类名引用
+    // 依赖 QtSql/QtNetwork 的 Appender 只在定义 QTRAPIDCORE_LOG_SQL/QTRAPIDCORE_LOG_NETWORK 时注册
+    static void registerExtensions();
+
+    // PropertyConfigurator 不解析过滤器，按 log4j 1.2 的 filter 语法补充挂载到对应 Appender
+    // target 非空时只配置该 Appender 的过滤器（增量重新加载新建、尚未挂载的 Appender）
+    void                     configureFilters(const Properties        &properties,
+                                              const AppenderSharedPtr &target = AppenderSharedPtr());
+    static AppenderSharedPtr findAppender(const QString &name);
+    // 按 log4j.appender.<name> 的配置新建并激活 Appender（不含过滤器），配置无效时返回空
+    static AppenderSharedPtr createAppender(const Properties &properties, const QString &name);
+
+    // 级别可能变化后使分类缓存失效，并同步 Qt 分类开关
+    static void levelsChanged();
+
+    void watchConfig();
+    void reload();
+    // 级别、已有对象的 LiveOptions 属性与 logger 挂载列表的变化原地应用，返回 false 表示需要完整重新配置
+    bool applyIncremental(const Properties &next);
+
+    static Properties loadProperties(const QString &confPath);
+
     Logger *m_LogAll; // TODO: 暂时不需要
 
-    static LogHelper *m_Instance;
-    static QMutex     m_Mutex;
+    // 以下成员由 m_configLock 保护
+    QMutex                          m_configLock;
+    QString                         m_confPath;
+    Properties                      m_properties;
+    QHash<QString, FilterSharedPtr> m_filters; // 键为 log4j.appender.<Appender>.filter.<ID>
+
+    QFileSystemWatcher *m_watcher;
+    QTimer             *m_reloadTimer;
+    QTimer             *m_levelTimer; // 定时检查未经 LogHelper 的级别修改
 };
 } // namespace Log
@@ -0,0 +1,116 @@
+﻿#include "logindexreader.h"
+
+#include <QtEndian>
+
+#include <climits>
+
+namespace Log {
+LogIndexReader::LogIndexReader(const QString &fileName)
+    : m_file(fileName)
+    , m_index(indexFileName(fileName))
+    , m_records(nullptr)
+    , m_count(0)
+    , m_region(nullptr)
+{
+}
+
+LogIndexReader::~LogIndexReader()
+{
+    close();
+}
+
+bool LogIndexReader::open()
+{
+    close();
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    // 写入中途崩溃可能留下不完整的末条记录，按整条记录截取
+    if (m_index.open(QIODevice::ReadOnly)) {
+        const qint64 count = m_index.size() / kRecordSize;
+        if (count > 0) {
+            m_records = m_index.map(0, count * kRecordSize);
+            if (m_records)
+                m_count = int(qMin<qint64>(count, INT_MAX));
+        }
+    }
+    return true;
+}
+
+void LogIndexReader::close()
+{
+    if (m_region) {
+        m_file.unmap(m_region);
+        m_region = nullptr;
+    }
+    if (m_records) {
+        m_index.unmap(const_cast<uchar *>(m_records));
+        m_records = nullptr;
+    }
+    m_count = 0;
+    m_index.close();
+    m_file.close();
+}
+
+qint64 LogIndexReader::timeAt(int i) const
+{
+    return qFromLittleEndian<qint64>(m_records + qint64(i) * kRecordSize);
+}
+
+qint64 LogIndexReader::offsetAt(int i) const
+{
+    return qFromLittleEndian<qint64>(m_records + qint64(i) * kRecordSize + 8);
+}
+
+int LogIndexReader::upperBound(qint64 timeStamp) const
+{
+    int low = 0;
+    int high = m_count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (timeAt(middle) <= timeStamp)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+qint64 LogIndexReader::seek(qint64 timeStamp) const
+{
+    // 最后一个早于 timeStamp 的索引点，之后的行时间都不早于该点
+    int low = 0;
+    int high = m_count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (timeAt(middle) < timeStamp)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low > 0 ? offsetAt(low - 1) : 0;
+}
+
+QByteArray LogIndexReader::map(qint64 from, qint64 to)
+{
+    if (m_region) {
+        m_file.unmap(m_region);
+        m_region = nullptr;
+    }
+    if (!m_file.isOpen())
+        return QByteArray();
+
+    const qint64 size = m_file.size();
+    const int    last = upperBound(to);
+    const qint64 begin = qMin(seek(from), size);
+    // Qt5 的 QByteArray 长度为 int，超大的时间段截断到 2GB
+    const qint64 end = qMin(last < m_count ? qMin(offsetAt(last), size) : size, begin + INT_MAX);
+    if (end <= begin)
+        return QByteArray();
+
+    m_region = m_file.map(begin, end - begin);
+    if (!m_region)
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_region), int(end - begin));
+}
+} // namespace Log
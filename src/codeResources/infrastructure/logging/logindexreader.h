@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+/*
+* 日志时间索引读取：
+*   GroupCommitFileAppender/AsyncRollingFileAppender 设置 indexInterval 后，每写入约 indexInterval 字节
+*   就在 <日志文件>.idx 中追加一条 16 字节的索引记录：事件时间戳（毫秒，int64 小端）+ 该行的字节偏移（int64 小端）
+*   索引中的时间戳单调不减，每个偏移都是一行的开头；滚动时索引随日志文件一起改名，压缩后的备份不保留索引
+*
+*   本类映射索引文件二分查找时间，再只映射日志文件中需要的区域，跳转到任意时间与文件大小无关
+*   返回的片段按索引点对齐，首尾可能多出不超过一个索引间隔的行，调用方按行内时间再过滤
+*
+*  Example:
+*   Log::LogIndexReader reader("logs/app.log.3");
+*   if (reader.open()) {
+*       const QByteArray text = reader.map(from, to);   // 在下一次 map/close 前有效
+*   }
+*/
+
+namespace Log {
+class LogIndexReader
+{
+public:
+    static constexpr int kRecordSize = 16;
+
+    static QString indexFileName(const QString &fileName) { return fileName + QStringLiteral(".idx"); }
+
+    explicit LogIndexReader(const QString &fileName);
+    ~LogIndexReader();
+
+    // 打开日志文件并映射索引；没有索引时仍可打开，seek 退化为从头读取
+    bool open();
+    void close();
+
+    bool   isIndexed() const { return m_count > 0; }
+    int    count() const { return m_count; }
+    qint64 timeAt(int i) const;
+    qint64 offsetAt(int i) const;
+
+    // 从返回的偏移开始顺序读取，不会漏掉时间不早于 timeStamp 的行
+    qint64 seek(qint64 timeStamp) const;
+
+    // 映射覆盖 [from, to] 时间段的日志片段，数据直接指向映射内存，在下一次 map 或 close 之前有效
+    QByteArray map(qint64 from, qint64 to);
+
+private:
+    Q_DISABLE_COPY(LogIndexReader)
+
+    // 第一个时间戳晚于 timeStamp 的索引点
+    int upperBound(qint64 timeStamp) const;
+
+    QFile        m_file;
+    QFile        m_index;
+    const uchar *m_records;
+    int          m_count;
+    uchar       *m_region;
+};
+} // namespace Log
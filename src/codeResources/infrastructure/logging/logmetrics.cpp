@@ -0,0 +1,314 @@
+﻿#include "logmetrics.h"
+#include "log4qt/logger.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSaveFile>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+#include <vector>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+// 分片按块分配，块指针发布后不再变化，汇总线程无需与写入线程同步扩容
+constexpr int kChunkSize = 256;
+constexpr int kMaxChunks = 1024;
+constexpr int kMaxCounters = kChunkSize * kMaxChunks;
+
+const Level::Value kLevels[] = {Level::TRACE_INT,
+                                Level::DEBUG_INT,
+                                Level::INFO_INT,
+                                Level::WARN_INT,
+                                Level::ERROR_INT,
+                                Level::FATAL_INT};
+constexpr int      kLevelCount = int(sizeof(kLevels) / sizeof(kLevels[0]));
+
+// 级别映射到 kLevels 下标，ALL/OFF 等归入最近的级别
+int levelIndex(Level level)
+{
+    const int value = level.toInt();
+    for (int i = kLevelCount - 1; i > 0; --i) {
+        if (value >= kLevels[i])
+            return i;
+    }
+    return 0;
+}
+
+QString keyOf(LogMetrics::Kind kind, const QString &name, int level)
+{
+    return QString::number(int(kind)) + QLatin1Char(':') + QString::number(level) + QLatin1Char(':') + name;
+}
+} // namespace
+
+struct LogMetrics::Shard
+{
+    Shard();
+    ~Shard();
+
+    std::atomic<quint64> *chunk(int index) const { return chunks[index].load(std::memory_order_acquire); }
+
+    std::atomic<std::atomic<quint64> *> chunks[kMaxChunks];
+
+    // 以下只由所属线程访问
+    QHash<const Logger *, int> emitted; // 值为该 logger 第一个级别计数器的编号，各级别编号连续
+    QHash<const Logger *, int> filtered;
+    QHash<QString, int>        named[Bytes + 1];
+};
+
+struct LogMetrics::Registry
+{
+    struct Counter
+    {
+        Kind    kind;
+        QString name;
+        int     level;
+    };
+
+    // 调用方持有 lock
+    int idOf(Kind kind, const QString &name, int level)
+    {
+        const QString key = keyOf(kind, name, level);
+        const auto    it = ids.constFind(key);
+        if (it != ids.constEnd())
+            return it.value();
+        if (counters.size() >= kMaxCounters)
+            return -1;
+        const int id = counters.size();
+        counters.append(Counter{kind, name, level});
+        ids.insert(key, id);
+        retired.push_back(0);
+        return id;
+    }
+
+    QMutex               lock;
+    QHash<QString, int>  ids;
+    QVector<Counter>     counters;
+    std::vector<quint64> retired; // 已退出线程的累计值
+    QVector<Shard *>     shards;
+    QTimer              *dumpTimer = nullptr;
+};
+
+LogMetrics::Shard::Shard()
+{
+    for (auto &c : chunks)
+        c.store(nullptr, std::memory_order_relaxed);
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+    r.shards.append(this);
+}
+
+LogMetrics::Shard::~Shard()
+{
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+    for (int c = 0; c < kMaxChunks; ++c) {
+        std::atomic<quint64> *values = chunk(c);
+        if (!values)
+            continue;
+        for (int i = 0; i < kChunkSize; ++i) {
+            const size_t id = size_t(c) * kChunkSize + i;
+            if (id < r.retired.size())
+                r.retired[id] += values[i].load(std::memory_order_relaxed);
+        }
+        delete[] values;
+    }
+    r.shards.removeOne(this);
+}
+
+LogMetrics::Registry &LogMetrics::registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+LogMetrics::Shard &LogMetrics::shard()
+{
+    thread_local Shard instance;
+    return instance;
+}
+
+int LogMetrics::counter(Kind kind, const QString &name, int level)
+{
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+    return r.idOf(kind, name, level);
+}
+
+void LogMetrics::add(int id, quint64 value)
+{
+    if (id < 0)
+        return;
+    Shard                &s = shard();
+    const int             index = id / kChunkSize;
+    std::atomic<quint64> *values = s.chunk(index);
+    if (!values) {
+        values = new std::atomic<quint64>[kChunkSize];
+        for (int i = 0; i < kChunkSize; ++i)
+            values[i].store(0, std::memory_order_relaxed);
+        s.chunks[index].store(values, std::memory_order_release);
+    }
+    // 只有所属线程写入，读取-写回即可，汇总线程读到的最多是稍旧的值
+    std::atomic<quint64> &slot = values[id % kChunkSize];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void LogMetrics::add(Kind kind, const QString &name, quint64 value)
+{
+    QHash<QString, int> &cache = shard().named[kind];
+    auto                 it = cache.constFind(name);
+    if (it == cache.constEnd())
+        it = cache.insert(name, counter(kind, name));
+    add(it.value(), value);
+}
+
+void LogMetrics::countEmitted(const Logger *logger, Level level)
+{
+    QHash<const Logger *, int> &cache = shard().emitted;
+    auto                        it = cache.constFind(logger);
+    if (it == cache.constEnd()) {
+        Registry &r = registry();
+        int       base;
+        {
+            QMutexLocker locker(&r.lock);
+            base = r.idOf(Emitted, logger->name(), kLevels[0]);
+            for (int i = 1; i < kLevelCount && base >= 0; ++i) {
+                // 同一 logger 的各级别在一次加锁中注册，编号连续
+                if (r.idOf(Emitted, logger->name(), kLevels[i]) != base + i)
+                    base = -1;
+            }
+        }
+        it = cache.insert(logger, base);
+    }
+    if (it.value() >= 0)
+        add(it.value() + levelIndex(level));
+}
+
+void LogMetrics::countFiltered(const Logger *logger)
+{
+    if (!logger)
+        return;
+    QHash<const Logger *, int> &cache = shard().filtered;
+    auto                        it = cache.constFind(logger);
+    if (it == cache.constEnd())
+        it = cache.insert(logger, counter(Filtered, logger->name()));
+    add(it.value());
+}
+
+quint64 LogMetrics::value(Kind kind, const QString &name, int level)
+{
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+    const int    id = r.ids.value(keyOf(kind, name, level), -1);
+    if (id < 0)
+        return 0;
+
+    quint64 total = r.retired[size_t(id)];
+    for (const Shard *s : qAsConst(r.shards)) {
+        if (const std::atomic<quint64> *values = s->chunk(id / kChunkSize))
+            total += values[id % kChunkSize].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+QJsonObject LogMetrics::snapshot()
+{
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+
+    std::vector<quint64> totals = r.retired;
+    for (const Shard *s : qAsConst(r.shards)) {
+        for (size_t id = 0; id < totals.size(); ++id) {
+            if (const std::atomic<quint64> *values = s->chunk(int(id / kChunkSize)))
+                totals[id] += values[id % kChunkSize].load(std::memory_order_relaxed);
+        }
+    }
+
+    QJsonObject loggers;
+    QJsonObject appenders;
+    for (int id = 0; id < r.counters.size(); ++id) {
+        const Registry::Counter &counter = r.counters.at(id);
+        const qint64             total = qint64(totals[size_t(id)]);
+        QJsonObject              owner = (counter.kind == Emitted || counter.kind == Filtered)
+                                             ? loggers.value(counter.name).toObject()
+                                             : appenders.value(counter.name).toObject();
+        switch (counter.kind) {
+        case Emitted: {
+            if (total == 0)
+                continue;
+            QJsonObject levels = owner.value(QStringLiteral("emitted")).toObject();
+            levels.insert(Level(Level::Value(counter.level)).toString(), total);
+            owner.insert(QStringLiteral("emitted"), levels);
+            break;
+        }
+        case Filtered:
+            owner.insert(QStringLiteral("filtered"), total);
+            break;
+        case Dropped:
+            owner.insert(QStringLiteral("dropped"), total);
+            break;
+        case Bytes:
+            owner.insert(QStringLiteral("bytes"), total);
+            break;
+        }
+        if (counter.kind == Emitted || counter.kind == Filtered)
+            loggers.insert(counter.name, owner);
+        else
+            appenders.insert(counter.name, owner);
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("time"), QDateTime::currentDateTime().toString(Qt::ISODateWithMs));
+    result.insert(QStringLiteral("loggers"), loggers);
+    result.insert(QStringLiteral("appenders"), appenders);
+    return result;
+}
+
+QByteArray LogMetrics::toJson()
+{
+    return QJsonDocument(snapshot()).toJson(QJsonDocument::Compact);
+}
+
+bool LogMetrics::dump(const QString &fileName)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(toJson());
+    return file.commit();
+}
+
+void LogMetrics::startDump(const QString &fileName, int interval)
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    Registry         &r = registry();
+    QMutexLocker      locker(&r.lock);
+    if (r.dumpTimer) {
+        r.dumpTimer->deleteLater();
+        r.dumpTimer = nullptr;
+    }
+    if (!app || fileName.isEmpty() || interval <= 0)
+        return;
+
+    // 定时器放到主线程，写文件不占用日志线程
+    auto *timer = new QTimer;
+    timer->moveToThread(app->thread());
+    QObject::connect(timer, &QTimer::timeout, timer, [fileName]() { dump(fileName); });
+    QMetaObject::invokeMethod(timer, [timer, interval]() { timer->start(interval); });
+    r.dumpTimer = timer;
+}
+
+void LogMetrics::stopDump()
+{
+    startDump(QString(), 0);
+}
+} // namespace Log
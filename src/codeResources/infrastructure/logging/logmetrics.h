@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include "log4qt/level.h"
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+namespace Log4Qt {
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 日志指标计数：
+*   不解析日志即可监控错误率等指标，统计以下计数：
+*     emitted：按 logger 与级别统计经 LOGINFO/LOGD/LOGSD 等宏及 Qt 消息桥接输出的事件（直接调用 Logger::info 等不统计）
+*     filtered：按 logger 统计被 SamplingFilter/RateLimitFilter 拒绝的事件，同一事件在多个 Appender 上被拒绝时分别计数
+*     dropped：按 Appender 统计因队列已满丢弃的事件（RingBufferAppender、BatchSignalAppender、LogStreamServerAppender）
+*     bytes：按 Appender 统计写入的字节数（GroupCommitFileAppender 及其子类，按字符数估算，ASCII 日志下与实际一致）
+*   计数按线程分片：每个线程只累加自己的分片，不加锁也没有原子读改写；读取时加锁汇总所有分片，
+*   线程退出时其分片并入汇总值
+*   计数器只增不减，由 snapshot() 导出为 JSON，startDump() 可定时覆盖写入指标文件
+*
+*  Example:
+*   Log::LogMetrics::startDump("logs/metrics.json", 10000);
+*   const QJsonObject metrics = Log::LogMetrics::snapshot();
+*   // {"time":"...","loggers":{"Network":{"emitted":{"ERROR":3,"INFO":120},"filtered":5}},
+*   //  "appenders":{"file":{"bytes":10240,"dropped":0}}}
+*/
+
+namespace Log {
+class LogMetrics
+{
+public:
+    enum Kind
+    {
+        Emitted,
+        Filtered,
+        Dropped,
+        Bytes
+    };
+
+    // 注册计数器并返回其编号，同一 kind/name/level 返回同一编号；需要加锁，适合激活时调用后缓存
+    // level 只对 Emitted 有意义
+    static int counter(Kind kind, const QString &name, int level = 0);
+
+    // 在当前线程的分片上累加，不加锁
+    static void add(int id, quint64 value = 1);
+    // 按名称累加，编号在线程内缓存，适合不在热路径上的计数（如丢弃）
+    static void add(Kind kind, const QString &name, quint64 value = 1);
+
+    static void countEmitted(const Log4Qt::Logger *logger, Log4Qt::Level level);
+    static void countFiltered(const Log4Qt::Logger *logger);
+
+    // 汇总所有线程分片
+    static quint64     value(Kind kind, const QString &name, int level = 0);
+    static QJsonObject snapshot();
+    static QByteArray  toJson();
+
+    // 把当前快照写入文件，先写临时文件再替换，读取方不会读到一半的内容
+    static bool dump(const QString &fileName);
+    // 在主线程的事件循环中每 interval 毫秒写入一次，再次调用替换之前的设置
+    static void startDump(const QString &fileName, int interval);
+    static void stopDump();
+
+private:
+    struct Shard;
+    struct Registry;
+
+    static Registry &registry();
+    static Shard    &shard();
+};
+} // namespace Log
@@ -0,0 +1,465 @@
+﻿#include "logstreamserverappender.h"
+#include "jsonlayout.h"
+#include "logmetrics.h"
+#include "log4qt/helpers/optionconverter.h"
+#include "log4qt/layout.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr int    kHandshakeTimeout = 1000;
+constexpr qint64 kMaxInFlight = 64 * 1024; // 已交给 socket 但尚未写出的字节上限
+constexpr int    kMaxCommandLength = 4096;
+
+struct Entry
+{
+    int        level;
+    QString    logger;
+    QByteArray data;
+};
+using EntryPtr = std::shared_ptr<const Entry>;
+
+struct Subscription
+{
+    int                         level = 0;
+    QStringList                 patterns;
+    QVector<QRegularExpression> loggers;
+
+    bool matches(const Entry &entry) const
+    {
+        if (entry.level < level)
+            return false;
+        if (loggers.isEmpty())
+            return true;
+        for (const QRegularExpression &logger : loggers) {
+            if (logger.match(entry.logger).hasMatch())
+                return true;
+        }
+        return false;
+    }
+
+    QByteArray describe() const
+    {
+        QByteArray text = "level=" + Level(Level::Value(level)).toString().toUtf8();
+        if (!patterns.isEmpty())
+            text += " logger=" + patterns.join(QLatin1Char(',')).toUtf8();
+        return text;
+    }
+};
+
+// SUBSCRIBE level=WARN logger=App.Network*,Db
+bool parseSubscription(const QString &line, Subscription *subscription)
+{
+    const QStringList tokens = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (tokens.isEmpty() || tokens.first().compare(QLatin1String("SUBSCRIBE"), Qt::CaseInsensitive) != 0)
+        return false;
+
+    Subscription result;
+    for (int i = 1; i < tokens.size(); ++i) {
+        const int separator = tokens.at(i).indexOf(QLatin1Char('='));
+        if (separator <= 0)
+            return false;
+        const QString key = tokens.at(i).left(separator).toLower();
+        const QString value = tokens.at(i).mid(separator + 1);
+        if (key == QLatin1String("level")) {
+            bool        ok = false;
+            const Level level = Level::fromString(value, &ok);
+            if (!ok)
+                return false;
+            result.level = level.toInt();
+        } else if (key == QLatin1String("logger")) {
+            for (const QString &pattern : value.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+                result.patterns.append(pattern);
+                result.loggers.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern)));
+            }
+        } else {
+            return false;
+        }
+    }
+    *subscription = result;
+    return true;
+}
+} // namespace
+
+// 日志线程与服务线程之间的接收队列
+struct LogStreamServerAppender::Intake
+{
+    QMutex               lock;
+    std::deque<EntryPtr> entries;
+    qint64               bytes = 0;
+    qint64               dropped = 0;
+    qint64               capacity = 0;
+    std::atomic<int>     clients{0};
+    std::atomic<int>     minLevel{0}; // 各客户端订阅级别的最小值，低于该级别的事件不格式化
+};
+
+// 运行在服务线程中，负责监听、握手、分发与写 socket
+class LogStreamServerAppender::Server : public QObject
+{
+public:
+    Server(std::shared_ptr<Intake> intake, qint64 bufferSize, int flushInterval)
+        : m_intake(std::move(intake))
+        , m_bufferSize(bufferSize)
+        , m_flushInterval(qMax(1, flushInterval))
+        , m_tcpServer(nullptr)
+        , m_localServer(nullptr)
+        , m_timer(new QTimer(this))
+    {
+        connect(m_timer, &QTimer::timeout, this, [this]() { flush(); });
+    }
+
+    void listen(const QString &address, int port, const QString &socketName)
+    {
+        Logger *logger = Logger::logger(QStringLiteral("Log::LogStreamServerAppender"));
+        if (port > 0) {
+            m_tcpServer = new QTcpServer(this);
+            if (m_tcpServer->listen(QHostAddress(address), quint16(port))) {
+                connect(m_tcpServer, &QTcpServer::newConnection, this, [this]() {
+                    while (QTcpSocket *socket = m_tcpServer->nextPendingConnection()) {
+                        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { remove(socket); });
+                        accept(socket);
+                    }
+                });
+            } else {
+                logger->error(QStringLiteral("Log stream server failed to listen on %1:%2: %3"),
+                              address,
+                              port,
+                              m_tcpServer->errorString());
+            }
+        }
+        if (!socketName.isEmpty()) {
+            m_localServer = new QLocalServer(this);
+            // 清理上次异常退出遗留的 Unix socket 文件
+            QLocalServer::removeServer(socketName);
+            if (m_localServer->listen(socketName)) {
+                connect(m_localServer, &QLocalServer::newConnection, this, [this]() {
+                    while (QLocalSocket *socket = m_localServer->nextPendingConnection()) {
+                        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { remove(socket); });
+                        accept(socket);
+                    }
+                });
+            } else {
+                logger->error(QStringLiteral("Log stream server failed to listen on '%1': %2"),
+                              socketName,
+                              m_localServer->errorString());
+            }
+        }
+        m_timer->start(m_flushInterval);
+    }
+
+    // 取出接收队列分发给各客户端，并尽量写出
+    void flush()
+    {
+        std::deque<EntryPtr> entries;
+        qint64               dropped;
+        {
+            QMutexLocker locker(&m_intake->lock);
+            entries.swap(m_intake->entries);
+            m_intake->bytes = 0;
+            dropped = m_intake->dropped;
+            m_intake->dropped = 0;
+        }
+
+        bool subscribed = false;
+        for (const auto &client : m_clients) {
+            if (!client->subscribed && client->since.elapsed() >= kHandshakeTimeout) {
+                client->subscribed = true;
+                subscribed = true;
+            }
+            client->dropped += dropped;
+            for (const EntryPtr &entry : entries)
+                enqueue(*client, entry);
+            write(*client);
+        }
+        if (subscribed)
+            updateMinLevel();
+    }
+
+private:
+    struct Client
+    {
+        QIODevice           *device = nullptr;
+        Subscription         subscription;
+        bool                 subscribed = false;
+        QElapsedTimer        since;
+        std::deque<EntryPtr> queue;
+        qint64               queuedBytes = 0;
+        qint64               dropped = 0;
+        QByteArray           command;
+    };
+
+    void accept(QIODevice *device)
+    {
+        auto client = std::make_unique<Client>();
+        client->device = device;
+        client->since.start();
+        connect(device, &QIODevice::readyRead, this, [this, device]() {
+            if (Client *client = find(device))
+                readCommands(*client);
+        });
+        connect(device, &QIODevice::bytesWritten, this, [this, device]() {
+            if (Client *client = find(device))
+                write(*client);
+        });
+        device->write("LOGSTREAM 1\n");
+
+        m_clients.push_back(std::move(client));
+        m_intake->clients.store(int(m_clients.size()));
+        updateMinLevel();
+    }
+
+    void remove(QIODevice *device)
+    {
+        // disconnected 可能在 write() 内部同步发出，延后到事件循环中移除
+        QMetaObject::invokeMethod(
+            this,
+            [this, device]() {
+                for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+                    if ((*it)->device == device) {
+                        m_clients.erase(it);
+                        break;
+                    }
+                }
+                device->deleteLater();
+                m_intake->clients.store(int(m_clients.size()));
+                updateMinLevel();
+            },
+            Qt::QueuedConnection);
+    }
+
+    Client *find(QIODevice *device) const
+    {
+        for (const auto &client : m_clients) {
+            if (client->device == device)
+                return client.get();
+        }
+        return nullptr;
+    }
+
+    void readCommands(Client &client)
+    {
+        client.command += client.device->readAll();
+        int newline;
+        while ((newline = client.command.indexOf('\n')) >= 0) {
+            const QString line = QString::fromUtf8(client.command.left(newline)).trimmed();
+            client.command.remove(0, newline + 1);
+            if (line.isEmpty())
+                continue;
+
+            Subscription subscription;
+            if (!parseSubscription(line, &subscription)) {
+                client.device->write("ERROR " + line.toUtf8() + '\n');
+                continue;
+            }
+            client.subscription = subscription;
+            client.subscribed = true;
+
+            // 握手前缓存的事件按新的订阅条件筛选
+            std::deque<EntryPtr> queue;
+            queue.swap(client.queue);
+            client.queuedBytes = 0;
+            for (const EntryPtr &entry : queue)
+                enqueue(client, entry);
+
+            client.device->write("OK " + subscription.describe() + '\n');
+            updateMinLevel();
+            write(client);
+        }
+        if (client.command.size() > kMaxCommandLength)
+            client.command.clear();
+    }
+
+    // 超出发送缓冲区时丢弃最旧的事件
+    void enqueue(Client &client, const EntryPtr &entry)
+    {
+        if (!client.subscription.matches(*entry))
+            return;
+        client.queue.push_back(entry);
+        client.queuedBytes += entry->data.size();
+        while (client.queuedBytes > m_bufferSize && client.queue.size() > 1) {
+            client.queuedBytes -= client.queue.front()->data.size();
+            client.queue.pop_front();
+            ++client.dropped;
+        }
+    }
+
+    // 合并为较大的块写出，socket 内部缓冲区只保留有限的数据，积压留在可丢弃的队列中
+    void write(Client &client)
+    {
+        if (!client.subscribed)
+            return;
+        while (!client.queue.empty() && client.device->bytesToWrite() < kMaxInFlight) {
+            QByteArray batch;
+            if (client.dropped > 0) {
+                batch = "# dropped " + QByteArray::number(client.dropped) + " events\n";
+                client.dropped = 0;
+            }
+            while (!client.queue.empty() && batch.size() < kMaxInFlight) {
+                batch += client.queue.front()->data;
+                client.queuedBytes -= client.queue.front()->data.size();
+                client.queue.pop_front();
+            }
+            client.device->write(batch);
+        }
+    }
+
+    // 握手前的客户端按不过滤计算
+    void updateMinLevel()
+    {
+        int level = Level::OFF_INT;
+        for (const auto &client : m_clients)
+            level = qMin(level, client->subscribed ? client->subscription.level : 0);
+        m_intake->minLevel.store(level);
+    }
+
+    std::shared_ptr<Intake>              m_intake;
+    qint64                               m_bufferSize;
+    int                                  m_flushInterval;
+    QTcpServer                          *m_tcpServer;
+    QLocalServer                        *m_localServer;
+    QTimer                              *m_timer;
+    std::vector<std::unique_ptr<Client>> m_clients;
+};
+
+LogStreamServerAppender::LogStreamServerAppender(QObject *parent)
+    : AppenderSkeleton(false, parent)
+    , m_address(QStringLiteral("127.0.0.1"))
+    , m_port(0)
+    , m_bufferSize(1024 * 1024)
+    , m_flushInterval(50)
+    , m_thread(nullptr)
+    , m_server(nullptr)
+{
+}
+
+LogStreamServerAppender::~LogStreamServerAppender()
+{
+    close();
+}
+
+void LogStreamServerAppender::setBufferSize(const QString &size)
+{
+    bool         ok;
+    const qint64 value = OptionConverter::toFileSize(size, &ok);
+    if (ok)
+        m_bufferSize = value;
+}
+
+void LogStreamServerAppender::activateOptions()
+{
+    // 重新激活时重启服务线程，端口等设置随之生效
+    stopServer();
+
+    QMutexLocker locker(&mObjectGuard);
+    if (m_port > 0 || !m_socketName.isEmpty()) {
+        m_intake = std::make_shared<Intake>();
+        m_intake->capacity = m_bufferSize;
+        m_thread = new QThread;
+        m_thread->setObjectName(QStringLiteral("LogStreamServer"));
+        m_server = new Server(m_intake, m_bufferSize, m_flushInterval);
+        m_server->moveToThread(m_thread);
+        connect(m_thread, &QThread::finished, m_server, &QObject::deleteLater);
+        m_thread->start();
+
+        // 不等待监听结果，失败时由服务线程记录错误
+        Server       *server = m_server;
+        const QString address = m_address;
+        const int     port = m_port;
+        const QString socketName = m_socketName;
+        QMetaObject::invokeMethod(m_server, [server, address, port, socketName]() {
+            server->listen(address, port, socketName);
+        });
+    } else {
+        logger()->warn(QStringLiteral("Neither port nor socketName is set for appender '%1'"), name());
+    }
+    AppenderSkeleton::activateOptions();
+}
+
+void LogStreamServerAppender::close()
+{
+    {
+        QMutexLocker locker(&mObjectGuard);
+        if (isClosed())
+            return;
+        AppenderSkeleton::close();
+    }
+    stopServer();
+}
+
+int LogStreamServerAppender::clientCount() const
+{
+    QMutexLocker locker(&mObjectGuard);
+    return m_intake ? m_intake->clients.load() : 0;
+}
+
+void LogStreamServerAppender::append(const LoggingEvent &event)
+{
+    // 没有客户端或没有客户端需要该级别时不格式化
+    Intake *intake = m_intake.get();
+    if (!intake || intake->clients.load(std::memory_order_relaxed) == 0
+        || event.level().toInt() < intake->minLevel.load(std::memory_order_relaxed))
+        return;
+
+    auto                  entry = std::make_shared<Entry>();
+    const LayoutSharedPtr layout = this->layout();
+    entry->level = event.level().toInt();
+    entry->logger = event.loggename();
+    if (auto *json = qobject_cast<JsonLayout *>(layout.data()))
+        entry->data = json->formatUtf8(event);
+    else
+        entry->data = layout->format(event).toUtf8();
+
+    quint64 dropped = 0;
+    {
+        QMutexLocker locker(&intake->lock);
+        intake->bytes += entry->data.size();
+        intake->entries.push_back(std::move(entry));
+        while (intake->bytes > intake->capacity && intake->entries.size() > 1) {
+            intake->bytes -= intake->entries.front()->data.size();
+            intake->entries.pop_front();
+            ++intake->dropped;
+            ++dropped;
+        }
+    }
+    if (dropped > 0)
+        LogMetrics::add(LogMetrics::Dropped, name(), dropped);
+}
+
+void LogStreamServerAppender::stopServer()
+{
+    QThread *thread = nullptr;
+    Server  *server = nullptr;
+    {
+        QMutexLocker locker(&mObjectGuard);
+        std::swap(thread, m_thread);
+        std::swap(server, m_server);
+        m_intake.reset();
+    }
+    if (!thread)
+        return;
+
+    // 发出剩余数据后退出，线程结束时删除 Server 及其连接
+    QMetaObject::invokeMethod(server, [server]() { server->flush(); }, Qt::BlockingQueuedConnection);
+    thread->quit();
+    thread->wait();
+    delete thread;
+}
+} // namespace Log
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "log4qt/appenderskeleton.h"
+
+#include <memory>
+
+class QThread;
+
+/*
+* 日志流服务Appender（替代 TelnetAppender）：
+*   TelnetAppender 在日志线程中逐个写所有连接，一个慢客户端就会拖住整个日志路径。
+*   本类的日志线程只把格式化后的 UTF-8 文本放入有界的接收队列，从不接触 socket；
+*   监听、握手、分发和写 socket 都在独立的服务线程中完成，每 flushInterval 毫秒批量写一次
+*
+*   监听：port > 0 时在 address:port 上监听 TCP（默认只监听 127.0.0.1），
+*         socketName 非空时同时监听本地 socket（Windows 命名管道 / Unix domain socket）
+*   每个客户端有独立的发送缓冲区（bufferSize，默认 1MB），写不出去时丢弃最旧的事件，
+*   下一批数据前插入一行 "# dropped N events"
+*
+*   协议（按行，UTF-8）：
+*     连接后服务端发送         LOGSTREAM 1
+*     客户端发送订阅（可选）   SUBSCRIBE level=WARN logger=App.Network*,Db
+*     服务端回复               OK level=WARN logger=App.Network*,Db
+*   level 为最低级别，logger 为逗号分隔的通配符，省略表示不限制；可随时重新订阅
+*   连接 1 秒内未订阅时按不过滤处理，握手前的事件会按订阅条件补发
+*
+*   依赖 QtNetwork，默认不注册：编译本文件、链接 Qt::Network 并定义 QTRAPIDCORE_LOG_NETWORK 后 log.conf 才能引用，
+*   例如 CMake 中 target_compile_definitions(app PRIVATE QTRAPIDCORE_LOG_NETWORK)
+*
+*  log.conf 示例：
+*   log4j.appender.stream=Log::LogStreamServerAppender
+*   log4j.appender.stream.port=9876
+*   log4j.appender.stream.socketName=MyApp.LogStream
+*   log4j.appender.stream.bufferSize=1MB
+*   log4j.appender.stream.flushInterval=50
+*   log4j.appender.stream.layout=Log::JsonLayout
+*/
+
+namespace Log {
+class LogStreamServerAppender : public Log4Qt::AppenderSkeleton
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString address READ address WRITE setAddress)
+    Q_PROPERTY(int port READ port WRITE setPort)
+    Q_PROPERTY(QString socketName READ socketName WRITE setSocketName)
+    Q_PROPERTY(QString bufferSize READ bufferSize WRITE setBufferSize)
+    Q_PROPERTY(int flushInterval READ flushInterval WRITE setFlushInterval)
+
+public:
+    explicit LogStreamServerAppender(QObject *parent = nullptr);
+    ~LogStreamServerAppender() override;
+
+    QString address() const { return m_address; }
+    int     port() const { return m_port; }
+    QString socketName() const { return m_socketName; }
+    QString bufferSize() const { return QString::number(m_bufferSize); }
+    int     flushInterval() const { return m_flushInterval; }
+
+    void setAddress(const QString &address) { m_address = address; }
+    void setPort(int port) { m_port = port; }
+    void setSocketName(const QString &name) { m_socketName = name; }
+    void setBufferSize(const QString &size);
+    void setFlushInterval(int msecs) { m_flushInterval = msecs; }
+
+    bool requiresLayout() const override { return true; }
+    void activateOptions() override;
+    void close() override;
+
+    // 当前连接的客户端数
+    int clientCount() const;
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+
+private:
+    struct Intake;
+    class Server;
+
+    void stopServer();
+
+    QString m_address;
+    int     m_port;
+    QString m_socketName;
+    qint64  m_bufferSize;
+    int     m_flushInterval;
+
+    std::shared_ptr<Intake> m_intake;
+    QThread                *m_thread;
+    Server                 *m_server;
+};
+} // namespace Log
@@ -0,0 +1,258 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QLatin1String>
+#include <QString>
+
+#include <charconv>
+#include <type_traits>
+
+/*
+* 单遍消息格式化：
+*   QString::arg 链式调用每个参数都会生成一个新的中间字符串，本实现一次扫描模板直接写入目标缓冲区
+*   占位符编号规则与 QString::arg 链式调用相同：出现过的 %1 ~ %99（含 %L1 形式）按编号从小到大依次对应各参数，
+*   缺少参数的占位符原样保留
+*   与 QString::arg 链式调用的差异：
+*     参数值中的 %n 不会被后续参数再次替换（链式调用会替换，日志内容含 % 时结果不同）
+*     不支持 fieldWidth/fillChar/进制/浮点格式等 arg() 的附加参数，需要时先自行转换成字符串
+*   %L1 对整数和浮点数按 QLocale 默认区域格式化，其他类型与 %1 相同
+*   整数使用 std::to_chars 转换，不产生堆分配；字符串、整数、浮点数以外的类型交给 QString::arg 转换
+*   模板可以是 QString，也可以是 UTF-8 字节串（字符串字面量、QByteArray，见 Utf8View）：
+*   UTF-8 模板直接按字节扫描，纯 ASCII 片段按 Latin-1 展开写入，不再先整体转换成临时 QString
+*
+*  Example:
+*   QString buffer;
+*   Log::formatMessage(buffer, "count %1, name %2", vec.count(), name);
+*/
+
+namespace Log {
+// 不持有数据的 UTF-8 字节串
+struct Utf8View
+{
+    const char *data;
+    int         size;
+};
+
+inline Utf8View utf8View(const char *text)
+{
+    return {text, text ? int(qstrlen(text)) : 0};
+}
+
+inline Utf8View utf8View(const QByteArray &text)
+{
+    return {text.constData(), text.size()};
+}
+
+namespace Detail {
+// 可以按 UTF-8 字节串处理的消息类型（字符串字面量、const char *、QByteArray）
+template<typename T>
+constexpr bool isUtf8Text = std::is_same_v<std::decay_t<T>, const char *> || std::is_same_v<std::decay_t<T>, char *>
+                            || std::is_same_v<std::decay_t<T>, QByteArray>;
+
+// 日志模板与参数绝大多数是 ASCII，此时按 Latin-1 直接展开，避免 fromUtf8 的临时字符串
+inline void appendUtf8(QString &out, const char *data, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        if (static_cast<uchar>(data[i]) >= 0x80) {
+            out.append(QString::fromUtf8(data, size));
+            return;
+        }
+    }
+    out.append(QLatin1String(data, size));
+}
+
+inline void appendArg(QString &out, const QString &value, bool = false)
+{
+    out.append(value);
+}
+
+inline void appendArg(QString &out, QLatin1String value, bool = false)
+{
+    out.append(value);
+}
+
+inline void appendArg(QString &out, const char *value, bool = false)
+{
+    const Utf8View view = utf8View(value);
+    appendUtf8(out, view.data, view.size);
+}
+
+inline void appendArg(QString &out, const QByteArray &value, bool = false)
+{
+    appendUtf8(out, value.constData(), value.size());
+}
+
+inline void appendArg(QString &out, QChar value, bool = false)
+{
+    out.append(value);
+}
+
+inline void appendArg(QString &out, char value, bool = false)
+{
+    out.append(QLatin1Char(value));
+}
+
+template<typename T>
+void appendArg(QString &out, const T &value, bool localized = false)
+{
+    if constexpr (std::is_arithmetic_v<T>) {
+        if (localized) {
+            using Number = std::conditional_t<std::is_same_v<T, bool>,
+                                              int,
+                                              std::conditional_t<std::is_floating_point_v<T>, double, T>>;
+            out.append(QStringLiteral("%L1").arg(static_cast<Number>(value)));
+            return;
+        }
+    }
+    if constexpr (std::is_enum_v<T>) {
+        appendArg(out, static_cast<std::underlying_type_t<T>>(value), localized);
+    } else if constexpr (std::is_integral_v<T>) {
+        // bool 与 QString::arg 一致按整数输出
+        char       buffer[24];
+        using Integer = std::conditional_t<std::is_same_v<T, bool>, int, T>;
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<Integer>(value));
+        out.append(QLatin1String(buffer, int(result.ptr - buffer)));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        out.append(QString::number(value, 'g', 6));
+    } else {
+        // QStringView、可隐式转换为数值的包装类型等，按 QString::arg 的重载决议转换
+        out.append(QStringLiteral("%1").arg(value));
+    }
+}
+
+inline void appendArgAt(QString &, int, bool) {}
+
+template<typename T, typename... Ts>
+void appendArgAt(QString &out, int index, bool localized, const T &value, const Ts &...rest)
+{
+    if (index == 0)
+        appendArg(out, value, localized);
+    else
+        appendArgAt(out, index - 1, localized, rest...);
+}
+
+// 数字字符的值，不是数字时返回 -1；QString 模板与 QString::arg 一样接受所有 Unicode 十进制数字
+inline int digitValue(QChar c)
+{
+    return c.isDigit() ? c.digitValue() : -1;
+}
+
+inline int digitValue(char c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : -1;
+}
+
+inline bool isPercent(QChar c)
+{
+    return c == QLatin1Char('%');
+}
+
+inline bool isPercent(char c)
+{
+    return c == '%';
+}
+
+inline void appendLiteral(QString &out, const QChar *data, int size)
+{
+    out.append(data, size);
+}
+
+inline void appendLiteral(QString &out, const char *data, int size)
+{
+    appendUtf8(out, data, size);
+}
+
+inline bool isLocaleFlag(QChar c)
+{
+    return c == QLatin1Char('L');
+}
+
+inline bool isLocaleFlag(char c)
+{
+    return c == 'L';
+}
+
+// 解析 pattern[pos] 处的占位符编号，返回编号（1 ~ 99）并通过 length 返回占位符长度、
+// localized 返回是否为 %L 形式，不是占位符时返回 0
+template<typename Char>
+int placeholderAt(const Char *pattern, int size, int pos, int *length, bool *localized)
+{
+    if (!isPercent(pattern[pos]))
+        return 0;
+    int digit = pos + 1;
+    *localized = digit < size && isLocaleFlag(pattern[digit]);
+    if (*localized)
+        ++digit;
+    if (digit >= size)
+        return 0;
+    int number = digitValue(pattern[digit]);
+    if (number < 0)
+        return 0;
+    const int second = digit + 1 < size ? digitValue(pattern[digit + 1]) : -1;
+    if (second >= 0) {
+        number = number * 10 + second;
+        ++digit;
+    }
+    *length = digit + 1 - pos;
+    return number;
+}
+
+template<typename Char, typename... Ts>
+void formatPattern(QString &out, const Char *pattern, int size, const Ts &...args)
+{
+    constexpr int argCount = int(sizeof...(Ts));
+
+    // 第一遍：记录出现过的编号，按从小到大的次序映射到参数下标
+    quint8 rank[100] = {};
+    int    length = 0;
+    bool   localized = false;
+    for (int i = 0; i < size; ++i) {
+        if (const int number = placeholderAt(pattern, size, i, &length, &localized))
+            rank[number] = 1;
+    }
+    int next = 0;
+    for (int number = 1; number < 100; ++number) {
+        if (rank[number])
+            rank[number] = quint8(++next);
+    }
+
+    // 第二遍：原文按段拷贝，占位符处写入对应参数
+    out.reserve(out.size() + size + argCount * 16);
+    int literalStart = 0;
+    for (int i = 0; i < size; ++i) {
+        const int number = placeholderAt(pattern, size, i, &length, &localized);
+        if (!number || rank[number] > argCount)
+            continue;
+        appendLiteral(out, pattern + literalStart, i - literalStart);
+        appendArgAt(out, rank[number] - 1, localized, args...);
+        i += length - 1;
+        literalStart = i + 1;
+    }
+    appendLiteral(out, pattern + literalStart, size - literalStart);
+}
+} // namespace Detail
+
+template<typename... Ts>
+void formatMessage(QString &out, const QString &pattern, const Ts &...args)
+{
+    Detail::formatPattern(out, pattern.constData(), pattern.size(), args...);
+}
+
+template<typename... Ts>
+void formatMessage(QString &out, Utf8View pattern, const Ts &...args)
+{
+    Detail::formatPattern(out, pattern.data, pattern.size, args...);
+}
+
+template<typename... Ts>
+void formatMessage(QString &out, const char *pattern, const Ts &...args)
+{
+    formatMessage(out, utf8View(pattern), args...);
+}
+
+template<typename... Ts>
+void formatMessage(QString &out, const QByteArray &pattern, const Ts &...args)
+{
+    formatMessage(out, utf8View(pattern), args...);
+}
+} // namespace Log
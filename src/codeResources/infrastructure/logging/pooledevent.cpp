@@ -0,0 +1,129 @@
+﻿#include "pooledevent.h"
+#include "logcontext.h"
+#include "logmetrics.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/mdc.h"
+#include "log4qt/ndc.h"
+
+#include <QDateTime>
+#include <QThread>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr int kPoolSize = 4;
+constexpr int kInitialCapacity = 256;
+constexpr int kMaxRetainedCapacity = 16 * 1024;
+} // namespace
+
+struct PooledEvent::Pool
+{
+    Slot     slots[kPoolSize];
+    int      depth = 0;
+    QThread *thread = nullptr;
+    QString  threadName;
+};
+
+PooledEvent::Pool &PooledEvent::pool()
+{
+    thread_local Pool instance;
+    return instance;
+}
+
+PooledEvent::PooledEvent()
+{
+    Pool &p = pool();
+    if (p.depth >= kPoolSize) {
+        m_slot = new Slot;
+        m_pooled = false;
+        return;
+    }
+
+    m_slot = &p.slots[p.depth++];
+    m_pooled = true;
+
+    // 上一条消息仍被异步 Appender 持有，或单条消息过大时放弃旧缓冲区
+    QString &buffer = m_slot->message;
+    if (!buffer.isDetached() || buffer.capacity() > kMaxRetainedCapacity)
+        buffer = QString();
+    buffer.resize(0);
+    if (buffer.capacity() < kInitialCapacity)
+        buffer.reserve(kInitialCapacity);
+}
+
+PooledEvent::~PooledEvent()
+{
+    if (!m_pooled) {
+        delete m_slot;
+        return;
+    }
+    m_slot->properties.clear();
+    --pool().depth;
+}
+
+void PooledEvent::setProperty(const QString &key, const QString &value)
+{
+    for (auto &property : m_slot->properties) {
+        if (property.first == key) {
+            property.second = value;
+            return;
+        }
+    }
+    m_slot->properties.append(qMakePair(key, value));
+}
+
+void PooledEvent::dispatch(Logger *logger, Level level)
+{
+    dispatch(logger, level, MessageContext());
+}
+
+void PooledEvent::dispatch(Logger *logger, Level level, const MessageContext &location)
+{
+    LogMetrics::countEmitted(logger, level);
+    const LogContext::Snapshot context = LogContext::capture();
+    const bool                 located = location.file || location.function;
+    if (context.isEmpty() && m_slot->properties.isEmpty() && !located) {
+        logger->log(level, m_slot->message);
+        return;
+    }
+
+    // 快照的属性表在事件间共享，只有同时使用 log4qt MDC 或带附加属性时才复制
+    QHash<QString, QString>       properties = context.properties();
+    const QHash<QString, QString> mdc = MDC::context();
+    for (auto it = mdc.constBegin(); it != mdc.constEnd(); ++it) {
+        if (!properties.contains(it.key()))
+            properties.insert(it.key(), it.value());
+    }
+    for (const auto &property : qAsConst(m_slot->properties))
+        properties.insert(property.first, property.second);
+
+    const QString ndc = context.ndc();
+    logger->log(LoggingEvent(logger,
+                             level,
+                             m_slot->message,
+                             ndc.isEmpty() ? NDC::peek() : ndc,
+                             properties,
+                             threadName(),
+                             QDateTime::currentMSecsSinceEpoch(),
+                             location,
+                             QString()));
+}
+
+const QString &PooledEvent::threadName()
+{
+    Pool    &p = pool();
+    QThread *current = QThread::currentThread();
+    if (p.thread != current) {
+        p.thread = current;
+        p.threadName = current->objectName();
+    }
+    return p.threadName;
+}
+
+void PooledEvent::refreshThreadName()
+{
+    pool().thread = nullptr;
+}
+} // namespace Log
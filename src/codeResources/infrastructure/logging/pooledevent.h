@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "log4qt/level.h"
+
+#include <QPair>
+#include <QString>
+#include <QVarLengthArray>
+
+namespace Log4Qt {
+class Logger;
+class MessageContext;
+} // namespace Log4Qt
+
+/*
+* 线程内复用的消息缓冲区：
+*   LoggingEvent 位于预编译的 log4qt 库中，Appender 接口也以它为参数，无法池化。
+*   本类只是 LoggingEvent 构造前的暂存区，池化的仅是消息缓冲区，dispatch() 每次仍会构造一个 LoggingEvent：
+*     消息缓冲区：格式化直接写入，事件结束后保留容量供下一条日志使用
+*     属性：少量属性存放在内联数组中，只在确有属性时才合并进 QHash（QHash 本身每次新建）
+*     线程名：按线程缓存，避免每条日志读取 QThread::objectName
+*     上下文：取 LogContext 的共享快照，上下文不变时不复制属性表（见 logcontext.h）
+*   同一线程内嵌套记录日志（如 Appender 内部再记日志）时依次使用池中的下一个缓冲区槽，
+*   池用尽后退化为普通的堆分配
+*
+*  Example:
+*   PooledEvent event;
+*   Log::formatMessage(event.message(), "count %1", count);
+*   event.dispatch(logger, Level::INFO_INT);
+*/
+
+namespace Log {
+class PooledEvent
+{
+public:
+    PooledEvent();
+    ~PooledEvent();
+
+    // 格式化目标缓冲区，取出时已清空
+    QString &message() { return m_slot->message; }
+
+    // 无需格式化时直接共享调用方的字符串
+    void setMessage(const QString &message) { m_slot->message = message; }
+
+    void setProperty(const QString &key, const QString &value);
+
+    // 转换为 LoggingEvent 交给 logger 输出
+    void dispatch(Log4Qt::Logger *logger, Log4Qt::Level level);
+    // 带调用位置（如 Qt 消息的 QMessageLogContext），context 中的字符串须为静态存储期
+    void dispatch(Log4Qt::Logger *logger, Log4Qt::Level level, const Log4Qt::MessageContext &context);
+
+    // 当前线程的线程名（线程改名后调用 refreshThreadName 更新）
+    static const QString &threadName();
+    static void           refreshThreadName();
+
+private:
+    Q_DISABLE_COPY(PooledEvent)
+
+    struct Slot
+    {
+        QString                                     message;
+        QVarLengthArray<QPair<QString, QString>, 4> properties;
+    };
+    struct Pool;
+
+    static Pool &pool();
+
+    Slot *m_slot;
+    bool  m_pooled;
+};
+} // namespace Log
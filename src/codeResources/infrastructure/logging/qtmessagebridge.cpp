@@ -0,0 +1,141 @@
+﻿#include "qtmessagebridge.h"
+#include "loggercache.h"
+#include "pooledevent.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/logmanager.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+const char kDefaultCategory[] = "default";
+
+// 以下由 s_lock 保护；过滤器在 Qt 注册表的锁内调用，读取 s_previousFilter 由该锁保证可见
+QMutex                           s_lock;
+bool                             s_installed = false;
+QtMessageHandler                 s_previousHandler = nullptr;
+QLoggingCategory::CategoryFilter s_previousFilter = nullptr;
+
+Level toLevel(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return Level(Level::DEBUG_INT);
+    case QtInfoMsg:
+        return Level(Level::INFO_INT);
+    case QtWarningMsg:
+        return Level(Level::WARN_INT);
+    case QtCriticalMsg:
+        return Level(Level::ERROR_INT);
+    case QtFatalMsg:
+        return Level(Level::FATAL_INT);
+    }
+    return Level(Level::WARN_INT);
+}
+
+Logger *loggerFor(const char *category)
+{
+    if (!category)
+        category = kDefaultCategory;
+
+    // 每个线程缓存分类名到 logger 的映射，处理消息时不加锁
+    thread_local QHash<QByteArray, Logger *> cache;
+    const QByteArray key = QByteArray::fromRawData(category, int(qstrlen(category)));
+    const auto       it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return it.value();
+
+    Logger *logger = qstrcmp(category, kDefaultCategory) == 0
+                         ? LoggerCache::logger(QStringLiteral("Qt"))
+                         : LoggerCache::logger(QLatin1String("Qt.") + QLatin1String(category));
+    cache.insert(QByteArray(key.constData(), key.size()), logger);
+    return logger;
+}
+
+// 与 LogCategory 相同：logger 的生效级别与仓库 threshold 中较高者
+int threshold(Logger *logger)
+{
+    return qMax(logger->effectiveLevel().toInt(), LogManager::threshold().toInt());
+}
+} // namespace
+
+void QtMessageBridge::install()
+{
+    QMutexLocker locker(&s_lock);
+    if (s_installed)
+        return;
+    s_installed = true;
+
+    // 传入 nullptr 恢复默认过滤器并取回原过滤器，保证安装自身过滤器时已能链式调用原过滤器
+    s_previousFilter = QLoggingCategory::installFilter(nullptr);
+    s_previousHandler = qInstallMessageHandler(&QtMessageBridge::handler);
+    QLoggingCategory::installFilter(&QtMessageBridge::filter);
+    qAddPostRoutine(&QtMessageBridge::uninstall);
+}
+
+void QtMessageBridge::uninstall()
+{
+    QMutexLocker locker(&s_lock);
+    if (!s_installed)
+        return;
+    s_installed = false;
+    qInstallMessageHandler(s_previousHandler);
+    QLoggingCategory::installFilter(s_previousFilter);
+}
+
+bool QtMessageBridge::isInstalled()
+{
+    QMutexLocker locker(&s_lock);
+    return s_installed;
+}
+
+void QtMessageBridge::refresh()
+{
+    // 重新安装同一个过滤器，Qt 会对所有已注册的分类再调用一次
+    QMutexLocker locker(&s_lock);
+    if (s_installed)
+        QLoggingCategory::installFilter(&QtMessageBridge::filter);
+}
+
+void QtMessageBridge::filter(QLoggingCategory *category)
+{
+    // 先按原有规则（QT_LOGGING_RULES、setFilterRules）设置，再关闭 logger 级别以下的消息类型
+    if (s_previousFilter)
+        s_previousFilter(category);
+
+    const int level = threshold(loggerFor(category->categoryName()));
+    for (const QtMsgType type : {QtDebugMsg, QtInfoMsg, QtWarningMsg, QtCriticalMsg}) {
+        if (category->isEnabled(type) && toLevel(type).toInt() < level)
+            category->setEnabled(type, false);
+    }
+}
+
+void QtMessageBridge::handler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    thread_local bool handling = false;
+    if (handling || type == QtFatalMsg) {
+        if (s_previousHandler)
+            s_previousHandler(type, context, message);
+        if (handling)
+            return;
+    }
+
+    handling = true;
+    Logger     *logger = loggerFor(context.category);
+    const Level level = toLevel(type);
+    // 过滤器已经拦下大部分消息，这里兜底未经分类开关的消息（如直接调用 qt_message_output）
+    if (level.toInt() >= threshold(logger)) {
+        PooledEvent event;
+        event.setMessage(message);
+        event.dispatch(logger, level, MessageContext(context.file, context.line, context.function));
+    }
+    handling = false;
+}
+} // namespace Log
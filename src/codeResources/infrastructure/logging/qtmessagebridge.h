@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <QtGlobal>
+
+class QLoggingCategory;
+class QMessageLogContext;
+class QString;
+
+/*
+* Qt 消息桥接：
+*   qDebug/qWarning 以及 Qt 内部的警告默认由 Qt 同步写到 stderr，不受 log4qt 级别和 Appender 控制。
+*   安装后 Qt 消息转换为日志事件，走与 LOGINFO 等宏相同的路径（PooledEvent -> logger -> Appender）
+*     logger 名称：默认分类为 Qt，其余分类为 Qt.<分类名>，如 Qt.qt.network.ssl
+*     级别对应：QtDebugMsg -> DEBUG，QtInfoMsg -> INFO，QtWarningMsg -> WARN，QtCriticalMsg -> ERROR，QtFatalMsg -> FATAL
+*     调用位置（文件、行号、函数）写入事件的 MessageContext，%F %L %M 可以输出
+*
+*   同时安装 QLoggingCategory 过滤器：把 logger 的生效级别折算到各分类的开关上（与 QT_LOGGING_RULES 等原有规则取交集），
+*   qCDebug(category) 等分类宏在级别未开启时直接跳过，不构造 QDebug、不求值参数；
+*   不带分类的 qDebug() 使用 default 分类，消息在流式拼接时已经生成，被关闭时由 Qt 在调用处理函数之前丢弃
+*   配置重新加载或运行时修改级别后，LogHelper 调用 refresh() 重新计算所有分类的开关
+*
+*   Appender 内部再触发的 Qt 消息以及 QtFatalMsg 同时交给原来的处理函数，避免递归并保证崩溃前的信息可见
+*   QCoreApplication 析构时自动卸载
+*
+*  Example:
+*   Log::LogHelper::installQtMessageHandler();
+*   // log.conf
+*   log4j.logger.Qt=WARN
+*   log4j.logger.Qt.qt.network=DEBUG
+*/
+
+namespace Log {
+class QtMessageBridge
+{
+public:
+    static void install();
+    static void uninstall();
+    static bool isInstalled();
+
+    // logger 级别变化后重新计算各 QLoggingCategory 的开关，未安装时不做任何事
+    static void refresh();
+
+private:
+    static void filter(QLoggingCategory *category);
+    static void handler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+};
+} // namespace Log
@@ -0,0 +1,257 @@
+﻿#include "ratelimitfilter.h"
+#include "logmetrics.h"
+#include "log4qt/appender.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/logmanager.h"
+
+#include <QDateTime>
+#include <QThread>
+#include <QTimer>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr int     kSlotCount = 1024; // 2 的幂，按位与取槽位
+constexpr int     kMaxProbe = 16;
+constexpr quint64 kTokenScale = 256;
+constexpr quint64 kClaiming = ~0ull; // 槽位正在初始化或回收，键值不会取到此值
+constexpr quint32 kDuplicateWindow = 5000; // summaryInterval 未设置时的重复消息窗口(ms)
+constexpr quint32 kIdleTimeout = 60000;    // 槽位空闲超过此时间(ms)后回收
+constexpr int     kSweepInterval = 10000;  // 不定时汇总时仍按此间隔回收槽位
+
+// 汇总事件带此属性，过滤器遇到时直接放行，避免被自身再次限流
+const QString kSummaryProperty = QStringLiteral("log.rateLimit.summary");
+
+quint64 mix(quint64 hash, quint64 value)
+{
+    hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+quint64 hashOf(const QString &text)
+{
+    quint64 hash = 0xCBF29CE484222325ull;
+    const ushort *data = text.utf16();
+    for (int i = 0; i < text.size(); ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash ? hash : 1;
+}
+} // namespace
+
+RateLimitFilter::RateLimitFilter(QObject *parent)
+    : Filter(parent)
+    , m_rate(100)
+    , m_burst(200)
+    , m_suppressDuplicates(true)
+    , m_summaryInterval(5000)
+    , m_slots(new Slot[kSlotCount])
+    , m_misses(0)
+    , m_reportedMisses(0)
+    , m_summaryTimer(new QTimer(this))
+{
+    m_clock.start();
+    connect(m_summaryTimer, &QTimer::timeout, this, &RateLimitFilter::onSummaryTimer);
+}
+
+RateLimitFilter::~RateLimitFilter() = default;
+
+void RateLimitFilter::activateOptions()
+{
+    // 令牌数以 1/256 为单位存放在 32 位中
+    m_burst = qBound(1, m_burst, int(0xFFFFFFFFull / kTokenScale));
+
+    // 不定时汇总时定时器仍要回收空闲槽位
+    const int interval = m_summaryInterval > 0 ? m_summaryInterval : kSweepInterval;
+    QMetaObject::invokeMethod(m_summaryTimer, [this, interval]() { m_summaryTimer->start(interval); });
+}
+
+Filter::Decision RateLimitFilter::decide(const LoggingEvent &event) const
+{
+    if (!event.property(kSummaryProperty).isEmpty())
+        return Filter::NEUTRAL;
+
+    const quint32 time = now();
+    Slot         *slot = findSlot(event, time);
+    if (!slot)
+        return Filter::NEUTRAL;
+    if (slot->lastUsed.load(std::memory_order_relaxed) != time)
+        slot->lastUsed.store(time, std::memory_order_relaxed);
+
+    if (m_suppressDuplicates) {
+        // 窗口从该消息放行时算起，重复不刷新时间，周期性的相同消息每个窗口放行一次
+        const quint64 hash = hashOf(event.message());
+        const quint64 message = quint64(quint32(hash ^ (hash >> 32)) | 1u) << 32;
+        const quint64 last = slot->lastMessage.load(std::memory_order_acquire);
+        const quint32 window = m_summaryInterval > 0 ? quint32(m_summaryInterval) : kDuplicateWindow;
+        if ((last & 0xFFFFFFFF00000000ull) == message && quint32(time - quint32(last)) < window) {
+            slot->repeated.fetch_add(1, std::memory_order_relaxed);
+            LogMetrics::countFiltered(event.logger());
+            return Filter::DENY;
+        }
+        slot->lastMessage.store(message | time, std::memory_order_release);
+    }
+
+    if (!tryAcquire(*slot)) {
+        slot->dropped.fetch_add(1, std::memory_order_relaxed);
+        LogMetrics::countFiltered(event.logger());
+        return Filter::DENY;
+    }
+
+    // 先输出之前积累的汇总，保证其出现在本条消息之前
+    emitSummary(*slot);
+    return Filter::NEUTRAL;
+}
+
+RateLimitFilter::Slot *RateLimitFilter::findSlot(const LoggingEvent &event, quint32 time) const
+{
+    quint64 key = mix(reinterpret_cast<quintptr>(event.logger()), quint64(event.level().toInt()));
+    if (event.lineNumber() > 0)
+        key = mix(mix(key, hashOf(event.fileName())), quint64(event.lineNumber()));
+    if (key == 0 || key == kClaiming)
+        key = 1;
+
+    // 槽位会被回收，探测链上可能有空洞，因此先找完整条链再占用第一个空槽，避免同一键占用两个槽
+    for (;;) {
+        Slot *empty = nullptr;
+        for (int probe = 0; probe < kMaxProbe; ++probe) {
+            Slot   &slot = m_slots[(key + probe) & (kSlotCount - 1)];
+            quint64 current = slot.key.load(std::memory_order_acquire);
+            while (current == kClaiming) {
+                QThread::yieldCurrentThread();
+                current = slot.key.load(std::memory_order_acquire);
+            }
+            if (current == key)
+                return &slot;
+            if (current == 0 && !empty)
+                empty = &slot;
+        }
+        if (!empty) {
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        // 先占位，logger 与装满的令牌桶写好后再发布键值，其他线程和汇总定时器不会看到未初始化的槽
+        quint64 expected = 0;
+        if (empty->key.compare_exchange_strong(expected, kClaiming, std::memory_order_acq_rel)) {
+            empty->logger.store(event.logger(), std::memory_order_relaxed);
+            empty->level.store(event.level().toInt(), std::memory_order_relaxed);
+            empty->bucket.store((quint64(time) << 32) | (quint64(m_burst) * kTokenScale), std::memory_order_relaxed);
+            empty->lastUsed.store(time, std::memory_order_relaxed);
+            empty->key.store(key, std::memory_order_release);
+            return empty;
+        }
+        // 空槽被其他线程抢先占用（可能正是同一个键），重新查找
+    }
+}
+
+bool RateLimitFilter::tryAcquire(Slot &slot) const
+{
+    if (m_rate <= 0)
+        return true;
+
+    // 槽位启用时桶已装满，启动时即可使用 burst
+    const quint32 now = this->now();
+    const quint64 capacity = quint64(m_burst) * kTokenScale;
+    quint64       old = slot.bucket.load(std::memory_order_relaxed);
+    for (;;) {
+        const quint32 last = quint32(old >> 32);
+        const quint64 refill = quint64(quint32(now - last)) * quint64(m_rate) * kTokenScale / 1000;
+        quint64       tokens = qMin(capacity, (old & 0xFFFFFFFFull) + refill);
+        const bool    granted = tokens >= kTokenScale;
+        if (granted)
+            tokens -= kTokenScale;
+
+        // 补充量不足一个单位时不推进时间戳，避免高频调用下令牌永远补不上
+        const quint64 next = (quint64(refill > 0 ? now : last) << 32) | tokens;
+        if (next == old)
+            return granted;
+        if (slot.bucket.compare_exchange_weak(old, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return granted;
+    }
+}
+
+quint32 RateLimitFilter::now() const
+{
+    return quint32(m_clock.elapsed());
+}
+
+void RateLimitFilter::emitSummary(Slot &slot) const
+{
+    // 没有 logger 时保留计数，留到下一次汇总，避免重置后汇总被静默丢弃
+    const Logger *logger = slot.logger.load(std::memory_order_acquire);
+    if (!logger)
+        return;
+
+    const quint32 repeated = slot.repeated.exchange(0, std::memory_order_acq_rel);
+    const quint32 dropped = slot.dropped.exchange(0, std::memory_order_acq_rel);
+    if (!repeated && !dropped)
+        return;
+
+    const int level = slot.level.load(std::memory_order_relaxed);
+    if (repeated)
+        postSummary(logger, level, QStringLiteral("Last message repeated %1 times").arg(repeated));
+    if (dropped)
+        postSummary(logger, level, QStringLiteral("%1 messages suppressed by rate limit").arg(dropped));
+}
+
+void RateLimitFilter::postSummary(const Logger *logger, int level, const QString &message) const
+{
+    if (!logger)
+        return;
+
+    const LoggingEvent summary(logger,
+                               Level(static_cast<Level::Value>(level)),
+                               message,
+                               QString(),
+                               {{kSummaryProperty, QStringLiteral("1")}},
+                               QThread::currentThread()->objectName(),
+                               QDateTime::currentMSecsSinceEpoch());
+    // Appender 的 doAppend 使用递归锁，decide() 内同线程重入是安全的
+    if (m_appender)
+        m_appender->doAppend(summary);
+    else
+        logger->callAppenders(summary);
+}
+
+void RateLimitFilter::releaseSlot(Slot &slot, quint64 key)
+{
+    // 占位后其他线程不会再找到该槽；已经拿到槽指针的线程可能仍在累加计数，
+    // 这些计数随槽位清零丢失，只影响一次汇总的数字
+    if (!slot.key.compare_exchange_strong(key, kClaiming, std::memory_order_acq_rel))
+        return;
+    slot.lastMessage.store(0, std::memory_order_relaxed);
+    slot.repeated.store(0, std::memory_order_relaxed);
+    slot.dropped.store(0, std::memory_order_relaxed);
+    slot.logger.store(nullptr, std::memory_order_relaxed);
+    slot.key.store(0, std::memory_order_release);
+}
+
+void RateLimitFilter::onSummaryTimer()
+{
+    const quint32 time = now();
+    for (int i = 0; i < kSlotCount; ++i) {
+        Slot         &slot = m_slots[i];
+        const quint64 key = slot.key.load(std::memory_order_acquire);
+        if (key == 0 || key == kClaiming)
+            continue;
+
+        const bool idle = quint32(time - slot.lastUsed.load(std::memory_order_relaxed)) >= kIdleTimeout;
+        if (m_summaryInterval > 0 || idle)
+            emitSummary(slot);
+        // 没有 logger 时 emitSummary 保留了计数，此时不回收
+        if (idle && !slot.repeated.load(std::memory_order_relaxed) && !slot.dropped.load(std::memory_order_relaxed))
+            releaseSlot(slot, key);
+    }
+
+    const quint64 misses = m_misses.load(std::memory_order_relaxed);
+    if (misses != m_reportedMisses) {
+        LogManager::logLogger()->warn(QStringLiteral("%1 events bypassed rate limit: slot table full"),
+                                      misses - m_reportedMisses);
+        m_reportedMisses = misses;
+    }
+}
+} // namespace Log
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include "log4qt/spi/filter.h"
+
+#include <QElapsedTimer>
+#include <QPointer>
+
+#include <atomic>
+#include <memory>
+
+class QTimer;
+
+namespace Log4Qt {
+class Appender;
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 限流过滤器：
+*   按 logger + 级别 + 调用位置（文件名、行号）划分计数槽，每个槽一个令牌桶：
+*     rate 为每秒补充的令牌数，burst 为桶容量，令牌耗尽后的事件被丢弃（rate <= 0 表示不限流）
+*   suppressDuplicates 为 true 时，同一槽内连续相同的消息在窗口内只输出第一条，
+*     后续重复以 "Last message repeated N times" 汇总；窗口为 summaryInterval（未设置时 5 秒），
+*     从该消息放行时算起，过后同一消息（如心跳）重新放行一次，不会被永久压制
+*   汇总在该槽下一条不同消息之前输出，或每隔 summaryInterval 毫秒定时输出
+*   计数槽为固定大小的无锁表，decide() 中不加锁；空闲超过 60 秒的槽由定时器输出汇总后回收，
+*     槽位仍然用尽时新调用位置不限流，次数计入 slotMisses() 并定时经 LogManager::logLogger() 告警
+*   事件没有调用位置信息时（如 LogHelper 的基础宏），按 logger + 级别计数
+*
+*  log.conf 示例（filter 后的 ID 决定同一 Appender 上多个过滤器的顺序）：
+*   log4j.appender.file.filter.1=Log::RateLimitFilter
+*   log4j.appender.file.filter.1.rate=50
+*   log4j.appender.file.filter.1.burst=200
+*   log4j.appender.file.filter.1.suppressDuplicates=true
+*   log4j.appender.file.filter.1.summaryInterval=5000
+*/
+
+namespace Log {
+class RateLimitFilter : public Log4Qt::Filter
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int rate READ rate WRITE setRate)
+    Q_PROPERTY(int burst READ burst WRITE setBurst)
+    Q_PROPERTY(bool suppressDuplicates READ suppressDuplicates WRITE setSuppressDuplicates)
+    Q_PROPERTY(int summaryInterval READ summaryInterval WRITE setSummaryInterval)
+
+public:
+    explicit RateLimitFilter(QObject *parent = nullptr);
+    ~RateLimitFilter() override;
+
+    int  rate() const { return m_rate; }
+    int  burst() const { return m_burst; }
+    bool suppressDuplicates() const { return m_suppressDuplicates; }
+    int  summaryInterval() const { return m_summaryInterval; }
+
+    void setRate(int rate) { m_rate = rate; }
+    void setBurst(int burst) { m_burst = burst; }
+    void setSuppressDuplicates(bool suppress) { m_suppressDuplicates = suppress; }
+    void setSummaryInterval(int msecs) { m_summaryInterval = msecs; }
+
+    // 汇总事件优先直接写回所属 Appender，未设置时交给事件的 logger 输出
+    void setAppender(Log4Qt::Appender *appender) { m_appender = appender; }
+
+    // 因槽位用尽而未限流的事件数
+    quint64 slotMisses() const { return m_misses.load(std::memory_order_relaxed); }
+
+    void     activateOptions() override;
+    Decision decide(const Log4Qt::LoggingEvent &event) const override;
+
+private:
+    struct Slot
+    {
+        std::atomic<quint64>                key{0};
+        std::atomic<quint64>                bucket{0}; // 高 32 位为上次补充时间(ms)，低 32 位为令牌数(1/256 个)
+        std::atomic<quint64>                lastMessage{0}; // 高 32 位为消息哈希，低 32 位为放行时间(ms)
+        std::atomic<quint32>                lastUsed{0};    // 最近一次命中的时间(ms)，用于回收空闲槽
+        std::atomic<quint32>                repeated{0};
+        std::atomic<quint32>                dropped{0};
+        std::atomic<const Log4Qt::Logger *> logger{nullptr};
+        std::atomic<int>                    level{0};
+    };
+
+    Slot   *findSlot(const Log4Qt::LoggingEvent &event, quint32 time) const;
+    bool    tryAcquire(Slot &slot) const;
+    void    releaseSlot(Slot &slot, quint64 key);
+    quint32 now() const; // 令牌桶使用的毫秒时钟
+    void    emitSummary(Slot &slot) const;
+    void    postSummary(const Log4Qt::Logger *logger, int level, const QString &message) const;
+    void    onSummaryTimer();
+
+    int  m_rate;
+    int  m_burst;
+    bool m_suppressDuplicates;
+    int  m_summaryInterval;
+
+    std::unique_ptr<Slot[]>      m_slots;
+    mutable std::atomic<quint64> m_misses;
+    quint64                      m_reportedMisses; // 只在定时器线程访问
+    QElapsedTimer                m_clock;
+    QTimer                      *m_summaryTimer;
+    QPointer<Log4Qt::Appender>   m_appender;
+};
+} // namespace Log
@@ -0,0 +1,127 @@
+﻿#include "ringbufferappender.h"
+#include "logmetrics.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/spi/filter.h"
+
+namespace Log {
+using namespace Log4Qt;
+
+RingBufferAppender::RingBufferAppender(QObject *parent)
+    : AppenderSkeleton(false, parent)
+    , m_capacity(65536)
+    , m_mask(0)
+    , m_tail(0)
+    , m_head(0)
+    , m_dropped(0)
+    , m_hasFilters(false)
+{
+}
+
+RingBufferAppender::~RingBufferAppender()
+{
+    close();
+}
+
+void RingBufferAppender::activateOptions()
+{
+    QMutexLocker locker(&mObjectGuard);
+    quint64 capacity = 2;
+    while (capacity < quint64(qMax(2, m_capacity)))
+        capacity <<= 1;
+    if (!m_cells) {
+        m_cells.reset(new Cell[capacity]);
+        for (quint64 i = 0; i < capacity; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_mask = capacity - 1;
+    } else if (capacity != m_mask + 1) {
+        logger()->warn(QStringLiteral("Capacity of ring buffer '%1' only takes effect on first activation"), name());
+    }
+    AppenderSkeleton::activateOptions();
+}
+
+void RingBufferAppender::addFilter(const FilterSharedPtr &filter)
+{
+    AppenderSkeleton::addFilter(filter);
+    m_hasFilters.store(true);
+}
+
+void RingBufferAppender::clearFilters()
+{
+    AppenderSkeleton::clearFilters();
+    m_hasFilters.store(false);
+}
+
+void RingBufferAppender::doAppend(const LoggingEvent &event)
+{
+    if (!m_cells || !isActive() || isClosed() || !isAsSevereAsThreshold(event.level()))
+        return;
+    if (m_hasFilters.load(std::memory_order_relaxed)) {
+        for (FilterSharedPtr filter = this->filter(); filter; filter = filter->next()) {
+            const Filter::Decision decision = filter->decide(event);
+            if (decision == Filter::DENY)
+                return;
+            if (decision == Filter::ACCEPT)
+                break;
+        }
+    }
+    push(event);
+}
+
+void RingBufferAppender::append(const LoggingEvent &event)
+{
+    push(event);
+}
+
+// 有界多生产者队列：每个槽位的序号等于写入位置时可写，等于写入位置 + 1 时可读
+void RingBufferAppender::push(const LoggingEvent &event)
+{
+    quint64 position = m_tail.load(std::memory_order_relaxed);
+    Cell   *cell;
+    for (;;) {
+        cell = &m_cells[position & m_mask];
+        const qint64 diff = qint64(cell->sequence.load(std::memory_order_acquire) - position);
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            LogMetrics::add(LogMetrics::Dropped, name());
+            return;
+        } else {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord &record = cell->record;
+    record.timeStamp = event.timeStamp();
+    record.level = event.level().toInt();
+    record.logger = event.loggename();
+    record.thread = event.threadName();
+    record.message = event.message();
+    cell->sequence.store(position + 1, std::memory_order_release);
+}
+
+int RingBufferAppender::drain(std::vector<LogRecord> &records, int maxCount)
+{
+    if (!m_cells)
+        return 0;
+    int count = 0;
+    while (count < maxCount) {
+        Cell &cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+            break;
+        records.push_back(std::move(cell.record));
+        cell.record = LogRecord();
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        ++m_head;
+        ++count;
+    }
+    return count;
+}
+
+quint64 RingBufferAppender::takeDropped()
+{
+    return m_dropped.exchange(0, std::memory_order_relaxed);
+}
+} // namespace Log
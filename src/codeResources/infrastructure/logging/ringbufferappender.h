@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "log4qt/appenderskeleton.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/*
+* 环形缓冲Appender（替代 ListAppender）：
+*   ListAppender 把事件存入无上限的 QList，每次读取都复制整个列表；
+*   本类把事件的原始字段放入固定容量的无锁环形队列，多个日志线程写入，一个消费者（通常是 GUI 线程）批量取出
+*   写入不经过 AppenderSkeleton 的对象锁，也不做格式化，消息文本与事件共享，不复制字符串内容
+*   队列已满时丢弃新事件并计数，消费者通过 takeDropped() 取得丢弃数
+*   capacity 会向上取整为 2 的幂，只在首次激活时生效
+*
+*  log.conf 示例：
+*   log4j.appender.ring=Log::RingBufferAppender
+*   log4j.appender.ring.capacity=65536
+*/
+
+namespace Log {
+// 环形缓冲区中的一条事件，显示时再格式化
+struct LogRecord
+{
+    qint64  timeStamp = 0;
+    int     level = 0;
+    QString logger;
+    QString thread;
+    QString message;
+};
+
+class RingBufferAppender : public Log4Qt::AppenderSkeleton
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity)
+
+public:
+    explicit RingBufferAppender(QObject *parent = nullptr);
+    ~RingBufferAppender() override;
+
+    int  capacity() const { return m_capacity; }
+    void setCapacity(int capacity) { m_capacity = capacity; }
+
+    bool requiresLayout() const override { return false; }
+    void activateOptions() override;
+
+    void addFilter(const Log4Qt::FilterSharedPtr &filter) override;
+    void clearFilters() override;
+
+    // 不经过对象锁，级别与过滤器判定后直接写入环形队列
+    void doAppend(const Log4Qt::LoggingEvent &event) override;
+
+    // 取出最多 maxCount 条事件追加到 records，返回取出的条数；同一时刻只能有一个消费者
+    int drain(std::vector<LogRecord> &records, int maxCount);
+
+    // 返回并清零因队列已满而丢弃的事件数
+    quint64 takeDropped();
+
+protected:
+    void append(const Log4Qt::LoggingEvent &event) override;
+
+private:
+    struct Cell
+    {
+        std::atomic<quint64> sequence;
+        LogRecord            record;
+    };
+
+    void push(const Log4Qt::LoggingEvent &event);
+
+    int m_capacity;
+
+    std::unique_ptr<Cell[]> m_cells;
+    quint64                 m_mask;
+    std::atomic<quint64>    m_tail; // 下一个写入位置
+    quint64                 m_head; // 下一个读取位置，只由消费者访问
+    std::atomic<quint64>    m_dropped;
+    std::atomic<bool>       m_hasFilters;
+};
+} // namespace Log
+
+Q_DECLARE_METATYPE(Log::LogRecord)
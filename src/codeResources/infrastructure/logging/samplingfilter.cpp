@@ -0,0 +1,380 @@
+﻿#include "samplingfilter.h"
+#include "logcontext.h"
+#include "logmetrics.h"
+#include "log4qt/appender.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/mdc.h"
+
+#include <QHash>
+#include <QMutex>
+
+#include <memory>
+#include <vector>
+
+namespace Log {
+using namespace Log4Qt;
+
+namespace {
+constexpr int     kCounterCount = 256;
+constexpr int     kMaxFilters = 64; // mark 为 64 位掩码
+constexpr quint64 kPercentScale = 1000000;
+
+const QString kMarkProperty = QStringLiteral("log.sampling");
+
+quint64 hashOf(const QString &text)
+{
+    quint64 hash = 0xCBF29CE484222325ull;
+    const ushort *data = text.utf16();
+    for (int i = 0; i < text.size(); ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// 与事件属性的合并规则一致：LogContext 中的键优先，没有时再查 log4qt MDC
+QString contextValue(const QString &key)
+{
+    const QString value = LogContext::get(key);
+    return !value.isEmpty() || LogContext::contains(key) ? value : MDC::get(key);
+}
+
+bool appliesTo(Level threshold, const QString &loggerPrefix, const Logger *logger, Level level)
+{
+    if (level > threshold)
+        return false;
+    return loggerPrefix.isEmpty() || (logger && logger->name().startsWith(loggerPrefix));
+}
+
+bool sampleWith(quint64                numerator,
+                quint64                denominator,
+                std::atomic<quint64> *counters,
+                const Logger          *logger,
+                const QString         &mdcValue)
+{
+    if (numerator >= denominator)
+        return true;
+
+    // 按值哈希，同一 MDC 值在所有线程和进程中判定一致
+    if (!mdcValue.isEmpty())
+        return hashOf(mdcValue) % denominator < numerator;
+
+    // 按 logger 计数，保留的事件均匀分布
+    std::atomic<quint64> &counter = counters[(reinterpret_cast<quintptr>(logger) >> 4) % kCounterCount];
+    const quint64         n = counter.fetch_add(1, std::memory_order_relaxed);
+    return (n + 1) * numerator / denominator > n * numerator / denominator;
+}
+
+// 注册时复制的过滤器参数，preSample 只读快照，不访问可能正在析构的过滤器对象
+struct Rule
+{
+    int                   id;
+    Level                 threshold;
+    QString               loggerPrefix;
+    QString               mdcKey;
+    quint64               numerator;
+    quint64               denominator;
+    std::atomic<quint64> *counters; // 计数块由注册表持有，不会释放
+};
+
+struct Snapshot
+{
+    std::vector<Rule> rules;
+};
+
+// 覆盖判定缓存：只增不删的开放寻址表，键写入后不变，判定结果与代数打包在 state 中原子更新
+struct CoverageEntry
+{
+    const Logger        *logger;
+    int                  level;
+    size_t               hash;
+    std::atomic<quint64> state{0}; // generation << 1 | result，代数不等于当前代数时视为未判定
+};
+
+struct CoverageTable
+{
+    explicit CoverageTable(size_t size)
+        : mask(size - 1)
+        , cells(new std::atomic<CoverageEntry *>[size])
+    {
+        for (size_t i = 0; i < size; ++i)
+            cells[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    const size_t                                          mask;
+    const std::unique_ptr<std::atomic<CoverageEntry *>[]> cells;
+};
+
+struct Registry
+{
+    std::atomic<const Snapshot *> snapshot{nullptr}; // nullptr 表示没有已注册的采样过滤器
+    std::atomic<CoverageTable *>  coverage{nullptr};
+    std::atomic<quint64>          generation{1}; // 失效时递增，旧的判定结果自然作废
+
+    // 以下由 lock 保护
+    QMutex                                               lock;
+    SamplingFilter                                      *filters[kMaxFilters] = {};
+    std::vector<std::unique_ptr<const Snapshot>>         snapshots; // 包括已被替换的旧快照，读者可能仍在访问
+    std::vector<std::unique_ptr<std::atomic<quint64>[]>> counterBlocks;
+    std::vector<std::atomic<quint64> *>                  freeCounters;
+    std::vector<std::unique_ptr<CoverageTable>>          tables; // 同上，旧表不释放
+    std::vector<std::unique_ptr<CoverageEntry>>          entries;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+size_t coverageHash(const Logger *logger, int level)
+{
+    return size_t(qHash(qMakePair(logger, level)));
+}
+
+CoverageEntry *findCoverage(const CoverageTable *table, const Logger *logger, int level, size_t hash)
+{
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        CoverageEntry *entry = table->cells[i].load(std::memory_order_acquire);
+        if (!entry)
+            return nullptr;
+        if (entry->hash == hash && entry->logger == logger && entry->level == level)
+            return entry;
+    }
+}
+
+void insertCoverage(CoverageTable *table, CoverageEntry *entry)
+{
+    size_t i = entry->hash & table->mask;
+    while (table->cells[i].load(std::memory_order_relaxed))
+        i = (i + 1) & table->mask;
+    // release 保证读者取得表项指针时键已经完整
+    table->cells[i].store(entry, std::memory_order_release);
+}
+} // namespace
+
+SamplingFilter::SamplingFilter(QObject *parent)
+    : Filter(parent)
+    , m_threshold(Level::DEBUG_INT)
+    , m_oneIn(0)
+    , m_percent(100.0)
+    , m_numerator(1)
+    , m_denominator(1)
+    , m_id(-1)
+    , m_counters(nullptr)
+{
+    // 计数块可能仍被旧快照引用，析构时归还注册表复用而不释放
+    Registry    &r = registry();
+    QMutexLocker locker(&r.lock);
+    if (r.freeCounters.empty()) {
+        r.counterBlocks.emplace_back(new std::atomic<quint64>[kCounterCount]);
+        m_counters = r.counterBlocks.back().get();
+    } else {
+        m_counters = r.freeCounters.back();
+        r.freeCounters.pop_back();
+    }
+    for (int i = 0; i < kCounterCount; ++i)
+        m_counters[i].store(0, std::memory_order_relaxed);
+}
+
+SamplingFilter::~SamplingFilter()
+{
+    Registry &r = registry();
+    {
+        QMutexLocker locker(&r.lock);
+        r.freeCounters.push_back(m_counters);
+        if (m_id < 0)
+            return;
+        r.filters[m_id] = nullptr;
+        publish();
+    }
+    invalidateCoverage();
+}
+
+void SamplingFilter::setPercent(const QString &percent)
+{
+    bool         ok;
+    const double value = percent.trimmed().remove(QLatin1Char('%')).toDouble(&ok);
+    if (ok)
+        m_percent = qBound(0.0, value, 100.0);
+}
+
+void SamplingFilter::activateOptions()
+{
+    if (m_oneIn > 0) {
+        m_numerator = 1;
+        m_denominator = quint64(m_oneIn);
+    } else {
+        m_numerator = quint64(qRound64(m_percent * kPercentScale / 100.0));
+        m_denominator = kPercentScale;
+    }
+
+    Registry &r = registry();
+    {
+        QMutexLocker locker(&r.lock);
+        for (int i = 0; i < kMaxFilters && m_id < 0; ++i) {
+            if (!r.filters[i]) {
+                r.filters[i] = this;
+                m_id = i;
+            }
+        }
+        // 参数变化后同样需要重新发布快照
+        if (m_id >= 0)
+            publish();
+    }
+    invalidateCoverage();
+}
+
+Filter::Decision SamplingFilter::decide(const LoggingEvent &event) const
+{
+    const Logger *logger = event.logger();
+    if (!applies(logger, event.level()))
+        return Filter::NEUTRAL;
+
+    // 已在格式化前判定过的事件直接使用判定结果，计数模式下不会重复采样
+    bool          keep;
+    const QString mark = event.property(kMarkProperty);
+    if (!mark.isEmpty() && m_id >= 0)
+        keep = (mark.toULongLong(nullptr, 16) >> m_id) & 1;
+    else
+        keep = sample(logger, m_mdcKey.isEmpty() ? QString() : event.property(m_mdcKey));
+    if (!keep)
+        LogMetrics::countFiltered(logger);
+    return keep ? Filter::NEUTRAL : Filter::DENY;
+}
+
+SamplingFilter::PreSample SamplingFilter::preSample(const Logger *logger, Level level, QString *mark)
+{
+    // 热路径不加锁：只读取已发布的不可变快照
+    const Snapshot *snapshot = registry().snapshot.load(std::memory_order_acquire);
+    if (!snapshot)
+        return NotSampled;
+
+    quint64 applied = 0;
+    quint64 kept = 0;
+    for (const Rule &rule : snapshot->rules) {
+        if (!appliesTo(rule.threshold, rule.loggerPrefix, logger, level))
+            continue;
+        applied |= 1ull << rule.id;
+        const QString mdcValue = rule.mdcKey.isEmpty() ? QString() : contextValue(rule.mdcKey);
+        if (sampleWith(rule.numerator, rule.denominator, rule.counters, logger, mdcValue))
+            kept |= 1ull << rule.id;
+    }
+
+    if (!applied)
+        return NotSampled;
+    if (!kept && covered(logger, level))
+        return Discard;
+    *mark = QString::number(kept, 16);
+    return Sampled;
+}
+
+void SamplingFilter::invalidateCoverage()
+{
+    registry().generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+QString SamplingFilter::markProperty()
+{
+    return kMarkProperty;
+}
+
+bool SamplingFilter::applies(const Logger *logger, Level level) const
+{
+    return appliesTo(m_threshold, m_loggerPrefix, logger, level);
+}
+
+bool SamplingFilter::sample(const Logger *logger, const QString &mdcValue) const
+{
+    return sampleWith(m_numerator, m_denominator, m_counters, logger, mdcValue);
+}
+
+void SamplingFilter::publish()
+{
+    // 调用方持有注册表锁
+    Registry &r = registry();
+    auto      snapshot = std::make_unique<Snapshot>();
+    for (int i = 0; i < kMaxFilters; ++i) {
+        const SamplingFilter *filter = r.filters[i];
+        if (filter) {
+            snapshot->rules.push_back({i,
+                                       filter->m_threshold,
+                                       filter->m_loggerPrefix,
+                                       filter->m_mdcKey,
+                                       filter->m_numerator,
+                                       filter->m_denominator,
+                                       filter->m_counters});
+        }
+    }
+    const Snapshot *published = snapshot->rules.empty() ? nullptr : snapshot.get();
+    if (published)
+        r.snapshots.push_back(std::move(snapshot));
+    r.snapshot.store(published, std::memory_order_release);
+}
+
+bool SamplingFilter::covered(const Logger *logger, Level level)
+{
+    // 只有 logger 可达的每个 Appender 都挂有适用的采样过滤器时，才能在格式化前丢弃
+    Registry     &r = registry();
+    const int     levelValue = level.toInt();
+    const size_t  hash = coverageHash(logger, levelValue);
+    const quint64 generation = r.generation.load(std::memory_order_acquire);
+    if (const CoverageTable *table = r.coverage.load(std::memory_order_acquire)) {
+        if (const CoverageEntry *entry = findCoverage(table, logger, levelValue, hash)) {
+            const quint64 state = entry->state.load(std::memory_order_acquire);
+            if (state >> 1 == generation)
+                return state & 1;
+        }
+    }
+
+    bool hasAppender = false;
+    bool result = true;
+    for (const Logger *current = logger; current && result;
+         current = current->additivity() ? current->parentLogger() : nullptr) {
+        const auto appenders = current->appenders();
+        for (const AppenderSharedPtr &appender : appenders) {
+            hasAppender = true;
+            bool sampled = false;
+            for (FilterSharedPtr filter = appender->filter(); filter && !sampled; filter = filter->next()) {
+                const auto *sampling = qobject_cast<SamplingFilter *>(filter.data());
+                sampled = sampling && sampling->m_id >= 0 && sampling->applies(logger, level);
+            }
+            if (!sampled) {
+                result = false;
+                break;
+            }
+        }
+    }
+    result = result && hasAppender;
+
+    // 未命中时才加锁写入；判定期间若已失效，写入的代数已过期，下次会重新判定
+    QMutexLocker   locker(&r.lock);
+    CoverageTable *table = r.coverage.load(std::memory_order_relaxed);
+    CoverageEntry *entry = table ? findCoverage(table, logger, levelValue, hash) : nullptr;
+    if (!entry) {
+        auto created = std::make_unique<CoverageEntry>();
+        created->logger = logger;
+        created->level = levelValue;
+        created->hash = hash;
+        entry = created.get();
+
+        // 装载因子保持在 1/2 以下，探测序列短且一定能遇到空槽
+        const size_t size = table ? table->mask + 1 : 0;
+        if ((r.entries.size() + 1) * 2 > size) {
+            auto grown = std::make_unique<CoverageTable>(size ? size * 2 : 64);
+            for (const auto &existing : r.entries)
+                insertCoverage(grown.get(), existing.get());
+            table = grown.get();
+            r.tables.push_back(std::move(grown));
+            insertCoverage(table, entry);
+            r.coverage.store(table, std::memory_order_release);
+        } else {
+            insertCoverage(table, entry);
+        }
+        r.entries.push_back(std::move(created));
+    }
+    entry->state.store(generation << 1 | quint64(result), std::memory_order_release);
+    return result;
+}
+} // namespace Log
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "log4qt/level.h"
+#include "log4qt/spi/filter.h"
+
+#include <atomic>
+
+namespace Log4Qt {
+class Logger;
+} // namespace Log4Qt
+
+/*
+* 采样过滤器：
+*   级别不高于 threshold（默认 DEBUG）的事件按比例保留，更高级别的事件不受影响
+*   oneIn = N 表示保留 N 条中的 1 条；未设置 oneIn 时按 percent 百分比保留（可为小数）
+*   loggerPrefix 非空时只对名称以该前缀开头的 logger 采样
+*   mdcKey 非空且事件带有该上下文值（LogContext 优先，其次 log4qt MDC）时按值的哈希一致采样，
+*     同一请求 ID 的所有日志同时保留或丢弃，且不同进程的判定结果一致；否则按 logger 计数均匀采样
+*
+*   LogHelper 在格式化消息之前调用 preSample() 做判定：所有可达 Appender 都会丢弃的事件
+*   不再格式化；保留的事件把判定结果写入事件属性，过滤器据此放行，不会重复采样
+*   preSample() 不加锁：注册与 activateOptions 时发布过滤器参数的不可变快照，覆盖判定缓存按代数失效，
+*   只有缓存未命中时才加锁写入；旧快照保留到进程退出，参数修改后需调用 activateOptions 才对 preSample 生效
+*
+*  log.conf 示例：
+*   log4j.appender.file.filter.1=Log::SamplingFilter
+*   log4j.appender.file.filter.1.threshold=DEBUG
+*   log4j.appender.file.filter.1.oneIn=100
+*   log4j.appender.file.filter.1.mdcKey=requestId
+*   log4j.appender.file.filter.1.loggerPrefix=Network
+*/
+
+namespace Log {
+class SamplingFilter : public Log4Qt::Filter
+{
+    Q_OBJECT
+
+    Q_PROPERTY(Log4Qt::Level threshold READ threshold WRITE setThreshold)
+    Q_PROPERTY(int oneIn READ oneIn WRITE setOneIn)
+    Q_PROPERTY(QString percent READ percent WRITE setPercent)
+    Q_PROPERTY(QString mdcKey READ mdcKey WRITE setMdcKey)
+    Q_PROPERTY(QString loggerPrefix READ loggerPrefix WRITE setLoggerPrefix)
+
+public:
+    // 格式化前的采样判定结果
+    enum PreSample
+    {
+        NotSampled, // 没有适用的采样过滤器
+        Sampled,    // 判定结果已写入 mark，需作为事件属性传递
+        Discard     // 所有可达 Appender 都会丢弃，无需格式化
+    };
+
+    explicit SamplingFilter(QObject *parent = nullptr);
+    ~SamplingFilter() override;
+
+    Log4Qt::Level threshold() const { return m_threshold; }
+    int           oneIn() const { return m_oneIn; }
+    QString       percent() const { return QString::number(m_percent); }
+    QString       mdcKey() const { return m_mdcKey; }
+    QString       loggerPrefix() const { return m_loggerPrefix; }
+
+    void setThreshold(Log4Qt::Level level) { m_threshold = level; }
+    void setOneIn(int count) { m_oneIn = count; }
+    void setPercent(const QString &percent);
+    void setMdcKey(const QString &key) { m_mdcKey = key; }
+    void setLoggerPrefix(const QString &prefix) { m_loggerPrefix = prefix; }
+
+    void     activateOptions() override;
+    Decision decide(const Log4Qt::LoggingEvent &event) const override;
+
+    static PreSample preSample(const Log4Qt::Logger *logger, Log4Qt::Level level, QString *mark);
+
+    // Appender 或过滤器挂载关系变化后清空覆盖判定缓存
+    static void invalidateCoverage();
+
+    // 保存判定结果的事件属性名
+    static QString markProperty();
+
+private:
+    bool applies(const Log4Qt::Logger *logger, Log4Qt::Level level) const;
+    bool sample(const Log4Qt::Logger *logger, const QString &mdcValue) const;
+
+    static bool covered(const Log4Qt::Logger *logger, Log4Qt::Level level);
+    static void publish();
+
+    Log4Qt::Level m_threshold;
+    int           m_oneIn;
+    double        m_percent;
+    QString       m_mdcKey;
+    QString       m_loggerPrefix;
+
+    // 保留比例 m_numerator / m_denominator，activateOptions 时由 oneIn/percent 换算
+    quint64 m_numerator;
+    quint64 m_denominator;
+
+    // 在注册表中的位序号，对应 mark 中的一位；-1 表示未注册
+    int m_id;
+
+    // 计数块由注册表分配，析构后归还复用，快照中的旧引用始终有效
+    std::atomic<quint64> *m_counters;
+};
+} // namespace Log
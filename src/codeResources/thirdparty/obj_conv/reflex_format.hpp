@@ -6,11 +6,29 @@
 #include <QtCore/QPair>
 
 namespace reflexjson {
+//stream the input through JsonSaxReader, only arrays selected by condition_t are built as DOM
 template<typename _type, typename... Args>
 static QPair<bool, std::string> json_to_obj(const std::string &str, _type &obj, bool isfile = false, Args &&...args)
 {
-    JsonReader reader(str, isfile);
-    return qMakePair(reader.convert(nullptr, obj, std::forward<Args>(args)...), reader.get_json());
+    JsonSaxReader reader(str, isfile);
+    bool          bret = reader.convert(nullptr, obj, std::forward<Args>(args)...);
+    return qMakePair(reader.finish() && bret, reader.get_json());
+}
+//parse file in place from a private mapping without keeping the raw json, the file on disk is not modified
+template<typename _type, typename... Args>
+static bool json_file_to_obj(const std::string &file, _type &obj, Args &&...args)
+{
+    JsonSaxReader reader(file, true, false);
+    bool          bret = reader.convert(nullptr, obj, std::forward<Args>(args)...);
+    return reader.finish() && bret;
+}
+//parse caller-owned buffer in place, the buffer content is overwritten
+template<typename _type, typename... Args>
+static bool json_buffer_to_obj(char *buffer, size_t len, _type &obj, Args &&...args)
+{
+    JsonSaxReader reader(buffer, len);
+    bool          bret = reader.convert(nullptr, obj, std::forward<Args>(args)...);
+    return reader.finish() && bret;
 }
 //"indentCount = 0"  show json format. "indentChar" show split character
 template<typename _type>
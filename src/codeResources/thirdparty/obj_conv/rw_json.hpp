@@ -6,11 +6,13 @@
 #endif
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +26,11 @@
 #include <QtCore/QVariant>
 #include <QtCore/QVector>
 #endif // QT
+// 文件映射只依赖 QtCore 的 QFile，与上面按 Qt 版本启用的容器支持无关，Qt6 下同样可用
+#if __has_include(<QtCore/QFile>)
+#include <QtCore/QFile>
+#define RW_JSON_HAS_QFILE 1
+#endif
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
@@ -68,9 +75,11 @@ protected:
     }
     const std::string key() const { return key_ != nullptr ? key_ : std::to_string(index_); }
 };
+class JsonSaxReader;
 class JsonReader : public Reader<JsonReader>
 {
     friend class Reader<JsonReader>;
+    friend class JsonSaxReader;
 
 private:
     std::string                                                    m_strData;
@@ -78,12 +87,24 @@ private:
     const rapidjson::Value                                        *val_;
     mutable std::shared_ptr<rapidjson::Value::ConstMemberIterator> iter_;
 
+    // 字段按声明顺序读取时下一个键通常就在游标处，未命中时再查按哈希排序的成员索引（首次未命中时建立）
+    // 游标命中后还要确认前面没有同名成员，与 FindMember 一样重复的键只取第一个：
+    // 游标之前的成员名哈希记在 256 位的布隆过滤器中，可能重名时按未命中处理，由完整查找返回第一个
+    using member_index_t = std::vector<std::pair<size_t, rapidjson::SizeType>>;
+    rapidjson::SizeType             cursor_;
+    rapidjson::SizeType             prefix_end_; // prefix_bloom_ 已记录 [0, prefix_end_) 的成员
+    uint64_t                        prefix_bloom_[4];
+    std::shared_ptr<member_index_t> member_index_;
+
 public:
     JsonReader(const std::string &str, bool isfile = false)
         : reader_doc_tpye(nullptr, "")
         , doc_(new rapidjson::Document())
         , val_(doc_.get())
         , m_strData("")
+        , cursor_(0)
+        , prefix_end_(0)
+        , prefix_bloom_{}
     {
         std::string err;
         do {
@@ -538,27 +559,40 @@ private:
         , doc_(nullptr)
         , val_(nullptr)
         , iter_(nullptr)
+        , cursor_(0)
+        , prefix_end_(0)
+        , prefix_bloom_{}
     {}
     JsonReader(const rapidjson::Value *val, const JsonReader *parent, const char *key)
         : reader_doc_tpye(parent, key)
         , doc_(nullptr)
         , val_(val)
         , iter_(nullptr)
+        , cursor_(0)
+        , prefix_end_(0)
+        , prefix_bloom_{}
     {}
     JsonReader(const rapidjson::Value *val, const JsonReader *parent, size_t index)
         : reader_doc_tpye(parent, index)
         , doc_(nullptr)
         , val_(val)
         , iter_(nullptr)
+        , cursor_(0)
+        , prefix_end_(0)
+        , prefix_bloom_{}
     {}
 
     JsonReader *child(const char *key, JsonReader *js_reader)
     {
-        rapidjson::Value::ConstMemberIterator iter;
-        if (nullptr != val_ && (iter = val_->FindMember(key)) != val_->MemberEnd() && !(iter->value.IsNull())) {
+        const rapidjson::Value *val = find_member(key);
+        if (nullptr != val && !(val->IsNull())) {
             js_reader->key_ = key;
             js_reader->parent_ = this;
-            js_reader->val_ = &iter->value;
+            js_reader->val_ = val;
+            js_reader->cursor_ = 0;
+            js_reader->prefix_end_ = 0;
+            std::fill(std::begin(js_reader->prefix_bloom_), std::end(js_reader->prefix_bloom_), 0);
+            js_reader->member_index_.reset();
             return js_reader;
         } else
             return nullptr;
@@ -567,12 +601,851 @@ private:
     {
         if (nullptr == key) {
             return val_;
-        } else if (nullptr != val_) {
-            rapidjson::Value::ConstMemberIterator iter = val_->FindMember(key);
-            return iter != val_->MemberEnd() && !(iter->value.IsNull()) ? &iter->value : nullptr;
         } else {
+            const rapidjson::Value *val = find_member(key);
+            return nullptr != val && !(val->IsNull()) ? val : nullptr;
+        }
+    }
+    const rapidjson::Value *find_member(const char *key)
+    {
+        if (nullptr == val_ || !val_->IsObject())
+            return nullptr;
+
+        const std::string_view                name(key);
+        const size_t                          hash = std::hash<std::string_view>()(name);
+        const rapidjson::SizeType             count = val_->MemberCount();
+        rapidjson::Value::ConstMemberIterator begin = val_->MemberBegin();
+        rapidjson::SizeType                   pos = cursor_;
+        if (pos >= count || member_name(begin + pos) != name || maybe_named_before(begin, pos, hash)) {
+            pos = count;
+            if (count <= 8) {
+                // 成员较少时直接扫描比建立索引更快
+                for (rapidjson::SizeType i = 0; i < count && pos == count; ++i) {
+                    if (member_name(begin + i) == name)
+                        pos = i;
+                }
+            } else {
+                if (nullptr == member_index_) {
+                    member_index_ = std::make_shared<member_index_t>();
+                    member_index_->reserve(count);
+                    for (rapidjson::SizeType i = 0; i < count; ++i)
+                        member_index_->emplace_back(std::hash<std::string_view>()(member_name(begin + i)), i);
+                    std::sort(member_index_->begin(), member_index_->end());
+                }
+                const member_index_t::value_type first(hash, 0);
+                auto                             iter = std::lower_bound(member_index_->begin(), member_index_->end(), first);
+                for (; iter != member_index_->end() && iter->first == first.first && pos == count; ++iter) {
+                    if (member_name(begin + iter->second) == name)
+                        pos = iter->second;
+                }
+            }
+            if (pos == count)
+                return nullptr;
+        }
+        cursor_ = pos + 1;
+        return &(begin + pos)->value;
+    }
+    // [0, pos) 中可能有同名成员时返回 true；游标回退后过滤器会包含 pos 之后的成员，只会多走完整查找
+    bool maybe_named_before(rapidjson::Value::ConstMemberIterator begin, rapidjson::SizeType pos, size_t hash)
+    {
+        for (; prefix_end_ < pos; ++prefix_end_) {
+            const size_t member_hash = std::hash<std::string_view>()(member_name(begin + prefix_end_));
+            prefix_bloom_[(member_hash >> 6) & 3] |= uint64_t(1) << (member_hash & 63);
+            prefix_bloom_[(member_hash >> 14) & 3] |= uint64_t(1) << ((member_hash >> 8) & 63);
+        }
+        return 0 != (prefix_bloom_[(hash >> 6) & 3] & (uint64_t(1) << (hash & 63)))
+               && 0 != (prefix_bloom_[(hash >> 14) & 3] & (uint64_t(1) << ((hash >> 8) & 63)));
+    }
+    static std::string_view member_name(rapidjson::Value::ConstMemberIterator iter)
+    {
+        return std::string_view(iter->name.GetString(), iter->name.GetStringLength());
+    }
+};
+// 流式读取：用 rapidjson::Reader 逐个拉取 SAX 事件直接填充 REFLEX_BIND 结构体，不建立 DOM，每个值只访问一次
+// 结构体每一轮调用 obj_to_struct 按声明顺序经过所有字段，键按声明顺序出现时一轮即可读完，乱序的键留到下一轮；
+// 键先与声明顺序上的下一个字段比较，不符时再查每个类型只建立一次的字段名哈希索引，未绑定的键整体跳过；转换规则与 JsonReader 一致：
+//   重复的键只取第一个；非 null 但类型不符的数组按空数组处理；结构体对应非 null 标量或不超过一个元素的数组时不读取字段但返回 true
+// tests/reflexjson 中的差分测试逐项比对两者的结果
+// 需要随机访问的 condition_t 数组只对该数组建立 DOM 后交给 JsonReader 处理
+// 读取字符串时直接引用 str，读取期间 str 必须保持有效
+// 原地解析：keep_json 为 false 的文件以私有（写时复制）方式映射后用 kParseInsituFlag 解析，不读入内存也不修改文件，
+// 字符串直接引用映射内容，不另外复制；此时不保留原始 json，get_json() 返回空（没有 QtCore 或映射失败时读入内存后原地解析）
+// 也可以传入调用方持有的可写缓冲区原地解析，解析过程会改写缓冲区内容
+class JsonSaxReader
+{
+    enum token_type
+    {
+        token_none, // 输入结束或出错
+        token_value,
+        token_key,
+        token_object_begin,
+        token_object_end,
+        token_array_begin,
+        token_array_end
+    };
+
+    // 只保存最近一个事件
+    struct token_handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, token_handler>
+    {
+        token_type          type_ = token_none;
+        rapidjson::Value    value_;
+        const char         *key_str_ = nullptr;
+        rapidjson::SizeType key_len_ = 0;
+        rapidjson::SizeType count_ = 0; // 结束事件的成员/元素个数
+        std::string         str_buf_;
+        std::string         key_buf_;
+
+        bool Null() { return set_value(value_.SetNull()); }
+        bool Bool(bool b) { return set_value(value_.SetBool(b)); }
+        bool Int(int i) { return set_value(value_.SetInt(i)); }
+        bool Uint(unsigned u) { return set_value(value_.SetUint(u)); }
+        bool Int64(int64_t i) { return set_value(value_.SetInt64(i)); }
+        bool Uint64(uint64_t u) { return set_value(value_.SetUint64(u)); }
+        bool Double(double d) { return set_value(value_.SetDouble(d)); }
+        bool String(const char *str, rapidjson::SizeType len, bool copy)
+        {
+            if (copy) {
+                str_buf_.assign(str, len);
+                str = str_buf_.c_str();
+            }
+            return set_value(value_.SetString(rapidjson::StringRef(str, len)));
+        }
+        bool Key(const char *str, rapidjson::SizeType len, bool copy)
+        {
+            if (copy) {
+                key_buf_.assign(str, len);
+                str = key_buf_.c_str();
+            }
+            key_str_ = str;
+            key_len_ = len;
+            return set(token_key, 0);
+        }
+        bool StartObject() { return set(token_object_begin, 0); }
+        bool EndObject(rapidjson::SizeType count) { return set(token_object_end, count); }
+        bool StartArray() { return set(token_array_begin, 0); }
+        bool EndArray(rapidjson::SizeType count) { return set(token_array_end, count); }
+
+        bool set_value(rapidjson::Value &) { return set(token_value, 0); }
+        bool set(token_type type, rapidjson::SizeType count)
+        {
+            type_ = type;
+            count_ = count;
+            return true;
+        }
+    };
+
+    // 原地解析的输入流，按长度判断结尾，映射的文件不需要以 '\0' 结尾
+    struct insitu_stream
+    {
+        typedef char Ch;
+
+        insitu_stream(char *src, size_t len)
+            : src_(src)
+            , dst_(nullptr)
+            , head_(src)
+            , end_(src + len)
+        {}
+
+        Ch     Peek() const { return src_ != end_ ? *src_ : '\0'; }
+        Ch     Take() { return src_ != end_ ? *src_++ : '\0'; }
+        size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+        Ch    *PutBegin() { return dst_ = src_; }
+        void   Put(Ch c) { *dst_++ = c; }
+        size_t PutEnd(Ch *begin) { return static_cast<size_t>(dst_ - begin); }
+        void   Flush() {}
+
+        Ch  *Push(size_t count)
+        {
+            Ch *begin = dst_;
+            dst_ += count;
+            return begin;
+        }
+        void Pop(size_t count) { dst_ -= count; }
+
+        Ch *src_;
+        Ch *dst_;
+        Ch *head_;
+        Ch *end_;
+    };
+
+    // 结构体字段名到声明序号的索引
+    struct field_index
+    {
+        std::vector<std::string>            names;
+        std::vector<std::pair<size_t, int>> sorted; // (哈希, 序号)，按哈希排序
+
+        // 先看声明顺序上的下一个字段，不符时按哈希查找，找不到返回 -1
+        int find(std::string_view key, int expected) const
+        {
+            if (expected < static_cast<int>(names.size()) && names[expected] == key)
+                return expected;
+            const std::pair<size_t, int> first(std::hash<std::string_view>()(key), -1);
+            for (auto iter = std::lower_bound(sorted.begin(), sorted.end(), first);
+                 iter != sorted.end() && iter->first == first.first;
+                 ++iter) {
+                if (names[iter->second] == key)
+                    return iter->second;
+            }
+            return -1;
+        }
+    };
+
+    // 正在读取的结构体对象
+    struct field_t
+    {
+        const field_index        *index;
+        std::vector<std::string> *names;   // 不为空时只收集字段名
+        int                       ordinal; // 本轮已经过的字段数
+        int                       target;  // 当前键对应的字段序号，-1 表示需要读取下一个键
+        int                       last;    // 上一个读取的字段序号
+        bool                      done;    // 对象已读完
+        uint64_t                  seen = 0; // 已出现过的字段（前 64 个），重复的键只取第一个
+        std::vector<bool>         seen_extra;
+
+        // 字段首次出现时返回 true
+        bool first_seen(int ordinal)
+        {
+            if (ordinal < 64) {
+                const uint64_t bit = uint64_t(1) << ordinal;
+                const bool     first = 0 == (seen & bit);
+                seen |= bit;
+                return first;
+            }
+            const size_t pos = static_cast<size_t>(ordinal - 64);
+            if (seen_extra.size() <= pos)
+                seen_extra.resize(pos + 1);
+            const bool first = !seen_extra[pos];
+            seen_extra[pos] = true;
+            return first;
+        }
+    };
+
+private:
+    std::string             m_strData;
+#ifdef RW_JSON_HAS_QFILE
+    QFile                   file_;
+#endif
+    std::string             source_;
+    const char             *json_;
+    size_t                  json_len_;
+    rapidjson::StringStream stream_;
+    insitu_stream           insitu_;
+    bool                    is_insitu_;
+    bool                    keep_json_;
+    rapidjson::Reader       reader_;
+    token_handler           token_;
+    bool                    pending_;
+    bool                    empty_array_; // enter_array 遇到类型不符的值，按空数组处理
+    field_t                *field_;
+    std::string             err_;
+
+public:
+    JsonSaxReader(const std::string &str, bool isfile = false, bool keep_json = true)
+        : source_(isfile ? "file [" + str + "]" : "string")
+        , json_(str.c_str())
+        , json_len_(str.size())
+        , stream_(json_)
+        , insitu_(nullptr, 0)
+        , is_insitu_(false)
+        , keep_json_(keep_json)
+        , pending_(false)
+        , empty_array_(false)
+        , field_(nullptr)
+    {
+        if (isfile && (keep_json || !map_file(str))) {
+            std::ifstream fs(str.c_str(), std::ifstream::binary);
+            if (!fs) {
+                err_ = "open file[" + str + "] fail.";
+                printf("error:%s\n", err_.c_str());
+            } else {
+                m_strData = std::string((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+            }
+            if (keep_json) {
+                json_ = m_strData.c_str();
+                json_len_ = m_strData.size();
+                stream_ = rapidjson::StringStream(json_);
+            } else {
+                set_insitu(m_strData.data(), m_strData.size());
+            }
+        }
+        reader_.IterativeParseInit();
+    }
+    JsonSaxReader(char *buffer, size_t len)
+        : source_("buffer")
+        , json_(buffer)
+        , json_len_(len)
+        , stream_("")
+        , insitu_(nullptr, 0)
+        , is_insitu_(false)
+        , keep_json_(false)
+        , pending_(false)
+        , empty_array_(false)
+        , field_(nullptr)
+    {
+        set_insitu(buffer, len);
+        reader_.IterativeParseInit();
+    }
+    ~JsonSaxReader() { m_strData.clear(); }
+
+public:
+    bool convert(const char *key, std::vector<char> &val)
+    {
+        std::string str;
+        if (!convert(key, str))
+            return false;
+        val.assign(str.begin(), str.end());
+        return true;
+    }
+    bool convert(const char *key, std::string &val) { JSON_GETVAL(GetString, IsString); }
+    bool convert(const char *key, int8_t &val) { JSON_GETVAL(GetInt, IsInt, (int8_t)); }
+    bool convert(const char *key, uint8_t &val) { JSON_GETVAL(GetInt, IsInt, (uint8_t)); }
+    bool convert(const char *key, int16_t &val) { JSON_GETVAL(GetInt, IsInt, (int16_t)); }
+    bool convert(const char *key, uint16_t &val) { JSON_GETVAL(GetInt, IsInt, (uint16_t)); }
+    bool convert(const char *key, int32_t &val) { JSON_GETVAL(GetInt, IsInt); }
+    bool convert(const char *key, uint32_t &val) { JSON_GETVAL(GetUint, IsUint); }
+    bool convert(const char *key, int64_t &val) { JSON_GETVAL(GetInt64, IsInt64); }
+    bool convert(const char *key, uint64_t &val) { JSON_GETVAL(GetUint64, IsUint64); }
+    bool convert(const char *key, double &val) { JSON_GETVAL(GetDouble, IsDouble); }
+    bool convert(const char *key, float &val) { JSON_GETVAL(GetFloat, IsDouble); }
+    bool convert(const char *key, bool &val)
+    {
+        const rapidjson::Value *v = get_val(key);
+        if (NULL == v) {
+            return false;
+        } else if (v->IsBool()) {
+            val = v->GetBool();
+            return true;
+        } else if (v->IsInt64()) {
+            val = (0 != (v->GetInt64()));
+            return true;
+        } else {
+            throw reflex_exption(std::string(key != nullptr ? key : "") + "wish bool, but not bool or int");
+            return false;
+        }
+    }
+    template<typename _type, typename = std::enable_if_t<std::is_enum_v<_type>>>
+    bool convert(const char *key, _type &enum_val)
+    {
+        typename std::underlying_type<_type>::type val;
+        if (!this->convert(key, val))
+            return false;
+        enum_val = static_cast<_type>(val);
+        return true;
+    }
+    template<typename _type, typename = std::enable_if_t<!std::is_same_v<_type, char>>>
+    bool convert(const char *key, std::vector<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        // 与 JsonReader 的 resize 一致，已有元素原地读取
+        size_t num = 0;
+        while (array_next()) {
+            if (num == val.size())
+                val.emplace_back();
+            this->convert(nullptr, val[num++]);
+        }
+        val.resize(num);
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, std::list<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        while (array_next()) {
+            _type elem;
+            this->convert(nullptr, elem);
+            val.emplace_back(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, std::set<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        while (array_next()) {
+            _type elem;
+            this->convert(nullptr, elem);
+            val.insert(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, std::map<std::string, _type> &val)
+    {
+        if (!enter(key, token_object_begin))
+            return false;
+        while (object_next()) {
+            const std::string name(token_.key_str_, token_.key_len_);
+            _type             elem;
+            this->convert(nullptr, elem);
+            val[name] = elem;
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, std::unordered_map<std::string, _type> &val)
+    {
+        if (!enter(key, token_object_begin))
+            return false;
+        while (object_next()) {
+            const std::string name(token_.key_str_, token_.key_len_);
+            _type             elem;
+            this->convert(nullptr, elem);
+            val[name] = elem;
+        }
+        return true;
+    }
+    template<typename... _type>
+    bool convert(const char *key, std::tuple<_type...> &data)
+    {
+        if (!enter_array(key))
+            return false;
+
+        bool more = true;
+        for_each_tuple(data, [this, &more](auto &&args) {
+            more = more && array_next();
+            if (more)
+                this->convert(nullptr, args);
+        });
+        if (more) {
+            while (array_next())
+                skip_value();
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, std::shared_ptr<_type> &val)
+    {
+        if (nullptr == val.get()) {
+            val.reset(new _type());
+        }
+        return this->convert(key, *val);
+    }
+#if (QT_VERSION < 0x060000)
+    bool convert(const char *key, QString &qval)
+    {
+        std::string val;
+        if (!convert(key, val))
+            return false;
+        qval = string2QString(val);
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QVector<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        int num = 0;
+        while (array_next()) {
+            if (num == val.size())
+                val.append(_type());
+            this->convert(nullptr, val[num++]);
+        }
+        val.resize(num);
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QList<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        val.clear();
+        while (array_next()) {
+            _type elem;
+            this->convert(nullptr, elem);
+            val.push_back(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QQueue<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        val.clear();
+        while (array_next()) {
+            _type elem;
+            this->convert(nullptr, elem);
+            val.append(elem);
+        }
+        return true;
+    }
+    bool convert(const char *key, QVariant &qval)
+    {
+        std::string val;
+        if (!convert(key, val))
+            return false;
+        QVariant tmp(string2QString(val));
+        bool     bOk = false;
+        int      iNum = tmp.toInt(&bOk);
+        if (bOk)
+            qval = iNum;
+        double dNum = tmp.toDouble(&bOk);
+        if (bOk)
+            qval = dNum;
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QList<_type *> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        val.clear();
+        while (array_next()) {
+            _type *elem = new _type;
+            this->convert(nullptr, *elem);
+            val.push_back(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QVector<_type *> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        val.clear();
+        while (array_next()) {
+            _type *elem = new _type;
+            this->convert(nullptr, *elem);
+            val.push_back(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QSet<_type> &val)
+    {
+        if (!enter_array(key))
+            return false;
+        while (array_next()) {
+            _type elem;
+            this->convert(nullptr, elem);
+            val.insert(elem);
+        }
+        return true;
+    }
+    template<typename _type>
+    bool convert(const char *key, QMap<QString, _type> &val)
+    {
+        if (!enter(key, token_object_begin))
+            return false;
+        while (object_next()) {
+            const QString name = QString::fromUtf8(token_.key_str_, int(token_.key_len_));
+            _type         elem;
+            this->convert(nullptr, elem);
+            val[name] = elem;
+        }
+        return true;
+    }
+    template<typename _type, typename... Args>
+    bool convert(const char *key, QSharedPointer<_type> &val, Args &&...args)
+    {
+        if (nullptr == val.get()) {
+            val.reset(new _type(std::forward<Args>(args)...));
+        }
+        return this->convert(key, *val);
+    }
+    template<typename _type, typename... Args>
+    bool convert(const char *key, std::unique_ptr<_type> &val, Args &&...args)
+    {
+        if (nullptr == val.get()) {
+            val.reset(new _type(std::forward<Args>(args)...));
+        }
+        return this->convert(key, *val);
+    }
+#endif
+    template<typename _type, std::enable_if_t<has_member_condition<_type>::value, bool> = true>
+    bool convert(const char *key, _type &val)
+    {
+        if (!accept(key))
+            return false;
+
+        bool bret = false;
+        switch (peek()) {
+        case token_object_begin:
+            take();
+            read_fields(val, true);
+            bret = true;
+            break;
+        case token_array_begin:
+            if (nullptr != val.cond_t_.cond_func_) {
+                rapidjson::Document doc;
+                auto                generator = [this](rapidjson::Document &handler) { return replay(handler); };
+                doc.Populate(generator);
+                if (doc.IsArray()) {
+                    JsonReader sub(&doc, nullptr, "");
+                    bret = sub.convert(nullptr, val);
+                }
+            } else {
+                // 与 JsonReader 一致：不超过一个元素的数组按没有成员的对象读取，结束事件带有元素个数
+                skip_value();
+                if (token_.count_ <= 1) {
+                    read_fields(val, false);
+                    bret = true;
+                }
+            }
+            break;
+        case token_value:
+            // 与 JsonReader 一致：非 null 标量按没有成员的对象读取，数组元素与根节点为 null 时也是如此
+            take();
+            if (nullptr == key || !token_.value_.IsNull()) {
+                read_fields(val, false);
+                bret = true;
+            }
+            break;
+        case token_none:
+            break;
+        default:
+            skip_value();
+            break;
+        }
+        val.cond_t_.set_value(nullptr, nullptr);
+        return bret;
+    }
+
+    // 读完剩余内容，输入有语法错误或根节点之后还有多余内容时返回 false
+    bool finish()
+    {
+        while (take() != token_none) {}
+        return err_.empty();
+    }
+    const std::string &error() const { return err_; }
+
+    std::string get_json() { return keep_json_ ? m_strData : std::string(); }
+
+private:
+#ifdef RW_JSON_HAS_QFILE
+    bool map_file(const std::string &path)
+    {
+        file_.setFileName(QString::fromLocal8Bit(path.c_str()));
+        if (!file_.open(QIODevice::ReadOnly) || file_.size() <= 0)
+            return false;
+        uchar *data = file_.map(0, file_.size(), QFileDevice::MapPrivateOption);
+        if (nullptr == data)
+            return false;
+        set_insitu(reinterpret_cast<char *>(data), static_cast<size_t>(file_.size()));
+        return true;
+    }
+#else
+    bool map_file(const std::string &) { return false; }
+#endif
+    void set_insitu(char *buffer, size_t len)
+    {
+        json_ = buffer;
+        json_len_ = len;
+        insitu_ = insitu_stream(buffer, len);
+        is_insitu_ = true;
+    }
+
+    void fetch()
+    {
+        token_.type_ = token_none;
+        while (token_.type_ == token_none && !reader_.IterativeParseComplete()) {
+            bool ok = is_insitu_ ? reader_.IterativeParseNext<rapidjson::kParseInsituFlag>(insitu_, token_)
+                                 : reader_.IterativeParseNext<rapidjson::kParseDefaultFlags>(stream_, token_);
+            if (!ok) {
+                token_.type_ = token_none;
+                if (err_.empty()) {
+                    size_t      offset = std::min(reader_.GetErrorOffset(), json_len_);
+                    std::string err_info(json_ + offset, std::min<size_t>(32, json_len_ - offset));
+                    err_ = "parse json " + source_ + " fail. " + err_info;
+                    printf("error:%s\n", err_.c_str());
+                }
+                break;
+            }
+        }
+    }
+    token_type peek()
+    {
+        if (!pending_) {
+            fetch();
+            pending_ = true;
+        }
+        return token_.type_;
+    }
+    token_type take()
+    {
+        token_type type = peek();
+        pending_ = false;
+        return type;
+    }
+
+    // 经过当前键对应的字段时接受，其余字段不读取输入
+    bool accept(const char *key)
+    {
+        if (nullptr == key)
+            return true;
+        field_t *field = field_;
+        if (nullptr == field)
+            return false;
+        if (nullptr != field->names) {
+            field->names->emplace_back(key);
+            return false;
+        }
+        const int ordinal = field->ordinal++;
+        next_field(*field);
+        if (field->target != ordinal)
+            return false;
+        field->last = ordinal;
+        field->target = -1;
+        return true;
+    }
+    // 还没有待读取的键时读取下一个能对应到字段的键，未绑定的键整体跳过
+    void next_field(field_t &field)
+    {
+        while (field.target < 0 && !field.done) {
+            if (!object_next()) {
+                field.done = true;
+                break;
+            }
+            field.target = field.index->find(std::string_view(token_.key_str_, token_.key_len_), field.last + 1);
+            if (field.target >= 0 && !field.first_seen(field.target))
+                field.target = -1;
+            if (field.target < 0)
+                skip_value();
+        }
+    }
+    // 按轮次经过结构体的所有字段直到对象读完；至少经过一轮，与 JsonReader 一样缺失的字段也会经过（如创建 shared_ptr）
+    template<typename _type>
+    void read_fields(_type &val, bool has_members)
+    {
+        field_t  field{&fields_of(val), nullptr, 0, -1, -1, !has_members};
+        field_t *outer = field_;
+        field_ = &field;
+        next_field(field);
+        do {
+            field.ordinal = 0;
+            val.obj_to_struct(*this);
+            next_field(field);
+        } while (field.target >= 0);
+        field_ = outer;
+    }
+    template<typename _type>
+    const field_index &fields_of(_type &val)
+    {
+        static const field_index index = collect_fields(val);
+        return index;
+    }
+    template<typename _type>
+    field_index collect_fields(_type &val)
+    {
+        field_index index;
+        field_t     field{nullptr, &index.names, 0, -1, -1, false};
+        field_t    *outer = field_;
+        field_ = &field;
+        val.obj_to_struct(*this);
+        field_ = outer;
+        for (int i = 0; i < static_cast<int>(index.names.size()); ++i)
+            index.sorted.emplace_back(std::hash<std::string_view>()(index.names[i]), i);
+        std::sort(index.sorted.begin(), index.sorted.end());
+        return index;
+    }
+    // 读取标量，null 与类型不符的对象/数组按缺失处理
+    const rapidjson::Value *get_val(const char *key)
+    {
+        if (!accept(key))
+            return nullptr;
+        if (peek() != token_value) {
+            skip_value();
             return nullptr;
         }
+        take();
+        return token_.value_.IsNull() ? nullptr : &token_.value_;
+    }
+    bool enter(const char *key, token_type begin)
+    {
+        if (!accept(key))
+            return false;
+        if (peek() != begin) {
+            skip_value();
+            return false;
+        }
+        take();
+        return true;
+    }
+    // 与 JsonReader 一致：缺失与字段值为 null 时返回 false，其他类型不符的值（包括数组元素与根节点的 null）整体跳过，按空数组处理
+    bool enter_array(const char *key)
+    {
+        if (!accept(key))
+            return false;
+        switch (peek()) {
+        case token_array_begin:
+            take();
+            return true;
+        case token_value:
+            take();
+            if (nullptr != key && token_.value_.IsNull())
+                return false;
+            empty_array_ = true;
+            return true;
+        case token_object_begin:
+            skip_value();
+            empty_array_ = true;
+            return true;
+        default:
+            return false;
+        }
+    }
+    bool array_next()
+    {
+        if (empty_array_) {
+            empty_array_ = false;
+            return false;
+        }
+        token_type type = peek();
+        if (token_array_end == type)
+            take();
+        return token_array_end != type && token_none != type;
+    }
+    bool object_next()
+    {
+        token_type type = take();
+        return token_key == type;
+    }
+    void skip_value()
+    {
+        rapidjson::BaseReaderHandler<> handler;
+        replay(handler);
+    }
+    // 把下一个完整的值依次转发给 handler
+    template<typename _handler>
+    bool replay(_handler &handler)
+    {
+        int depth = 0;
+        do {
+            switch (take()) {
+            case token_value:
+                if (token_.value_.IsString())
+                    handler.String(token_.value_.GetString(), token_.value_.GetStringLength(), true);
+                else
+                    token_.value_.Accept(handler);
+                break;
+            case token_key:
+                handler.Key(token_.key_str_, token_.key_len_, true);
+                break;
+            case token_object_begin:
+                handler.StartObject();
+                ++depth;
+                break;
+            case token_object_end:
+                handler.EndObject(token_.count_);
+                --depth;
+                break;
+            case token_array_begin:
+                handler.StartArray();
+                ++depth;
+                break;
+            case token_array_end:
+                handler.EndArray(token_.count_);
+                --depth;
+                break;
+            default:
+                return false;
+            }
+        } while (depth > 0);
+        return true;
     }
 };
 class JsonWriter
@@ -0,0 +1,223 @@
+﻿#include "logconsolemodel.h"
+#include "log4qt/level.h"
+#include "log4qt/logger.h"
+#include "log4qt/logmanager.h"
+
+#include <QBrush>
+#include <QDateTime>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <memory>
+
+using namespace Log4Qt;
+
+namespace {
+constexpr int kFrameInterval = 16;
+constexpr int kMaxBatch = 65536; // 一帧最多取出的事件数，界面长时间阻塞后分几帧追上
+} // namespace
+
+LogConsoleModel::LogConsoleModel(QObject *parent)
+    : LogConsoleModel(nullptr, parent)
+{
+}
+
+LogConsoleModel::LogConsoleModel(Logger *logger, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_ring(new Log::RingBufferAppender)
+    , m_logger(logger ? logger : LogManager::rootLogger())
+    , m_timer(new QTimer(this))
+    , m_maxLines(100000)
+    , m_first(0)
+{
+    m_appender = AppenderSharedPtr(m_ring);
+    m_ring->setName(QStringLiteral("LogConsole"));
+    m_ring->activateOptions();
+    m_logger->addAppender(m_appender);
+
+    connect(&m_watcher, &QFutureWatcher<FilterResult>::finished, this, &LogConsoleModel::applyFilterResult);
+    connect(m_timer, &QTimer::timeout, this, &LogConsoleModel::poll);
+    m_timer->start(kFrameInterval);
+}
+
+LogConsoleModel::~LogConsoleModel()
+{
+    m_logger->removeAppender(m_appender);
+    m_appender->close();
+    m_watcher.waitForFinished();
+}
+
+int LogConsoleModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_rows.size());
+}
+
+QVariant LogConsoleModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= int(m_rows.size()))
+        return QVariant();
+
+    // 只有可见行会被请求，在这里才格式化
+    const Log::LogRecord &entry = record(m_rows[size_t(index.row())]);
+    switch (role) {
+    case Qt::DisplayRole: {
+        QString message = entry.message;
+        message.replace(QLatin1Char('\n'), QLatin1Char(' '));
+        return QStringLiteral("%1 %2 [%3] %4 - %5")
+            .arg(QDateTime::fromMSecsSinceEpoch(entry.timeStamp).toString(QStringLiteral("hh:mm:ss.zzz")),
+                 Level(Level::Value(entry.level)).toString().leftJustified(5),
+                 entry.thread,
+                 entry.logger,
+                 message);
+    }
+    case Qt::ToolTipRole:
+        return entry.message;
+    case Qt::ForegroundRole:
+        if (entry.level >= Level::ERROR_INT)
+            return QBrush(Qt::red);
+        if (entry.level >= Level::WARN_INT)
+            return QBrush(QColor(0xd0, 0x80, 0x00));
+        if (entry.level < Level::INFO_INT)
+            return QBrush(Qt::gray);
+        return QVariant();
+    case LevelRole:
+        return entry.level;
+    case TimeStampRole:
+        return entry.timeStamp;
+    case LoggerRole:
+        return entry.logger;
+    case ThreadRole:
+        return entry.thread;
+    case MessageRole:
+        return entry.message;
+    default:
+        return QVariant();
+    }
+}
+
+void LogConsoleModel::setMaxLines(int lines)
+{
+    m_maxLines = qMax(1, lines);
+    trim();
+}
+
+void LogConsoleModel::setFilter(int level, const QString &text)
+{
+    if (level == m_filter.level && text == m_filter.text)
+        return;
+    m_filter.level = level;
+    m_filter.text = text;
+    startFilter();
+}
+
+void LogConsoleModel::clear()
+{
+    beginResetModel();
+    m_first += m_records.size();
+    m_records.clear();
+    m_rows.clear();
+    endResetModel();
+}
+
+bool LogConsoleModel::Filter::matches(const Log::LogRecord &record) const
+{
+    if (record.level < level)
+        return false;
+    if (text.isEmpty())
+        return true;
+    return record.message.contains(text, Qt::CaseInsensitive) || record.logger.contains(text, Qt::CaseInsensitive);
+}
+
+void LogConsoleModel::poll()
+{
+    m_ring->drain(m_batch, kMaxBatch);
+    if (const quint64 dropped = m_ring->takeDropped()) {
+        Log::LogRecord notice;
+        notice.timeStamp = QDateTime::currentMSecsSinceEpoch();
+        notice.level = Level::WARN_INT;
+        notice.logger = m_ring->name();
+        notice.message = tr("环形缓冲区已满，丢弃了 %1 条事件").arg(dropped);
+        m_batch.push_back(std::move(notice));
+    }
+    if (m_batch.empty())
+        return;
+
+    const quint64 begin = m_first + m_records.size();
+    for (Log::LogRecord &entry : m_batch)
+        m_records.push_back(std::move(entry));
+    m_batch.clear();
+    trim();
+
+    // 重新筛选期间新记录只入库，结果返回时统一补充
+    if (m_watcher.isRunning())
+        return;
+
+    const quint64        end = m_first + m_records.size();
+    std::vector<quint64> rows;
+    for (quint64 sequence = qMax(begin, m_first); sequence < end; ++sequence) {
+        if (m_filter.matches(record(sequence)))
+            rows.push_back(sequence);
+    }
+    if (rows.empty())
+        return;
+
+    const int first = int(m_rows.size());
+    beginInsertRows(QModelIndex(), first, first + int(rows.size()) - 1);
+    m_rows.insert(m_rows.end(), rows.begin(), rows.end());
+    endInsertRows();
+}
+
+void LogConsoleModel::trim()
+{
+    if (m_records.size() <= size_t(m_maxLines))
+        return;
+    const size_t excess = m_records.size() - size_t(m_maxLines);
+    m_records.erase(m_records.begin(), m_records.begin() + excess);
+    m_first += excess;
+
+    size_t removed = 0;
+    while (removed < m_rows.size() && m_rows[removed] < m_first)
+        ++removed;
+    if (removed == 0)
+        return;
+    beginRemoveRows(QModelIndex(), 0, int(removed) - 1);
+    m_rows.erase(m_rows.begin(), m_rows.begin() + removed);
+    endRemoveRows();
+}
+
+void LogConsoleModel::startFilter()
+{
+    // 记录内容与事件共享，快照只增加引用计数
+    auto          snapshot = std::make_shared<std::vector<Log::LogRecord>>(m_records.begin(), m_records.end());
+    const quint64 first = m_first;
+    const Filter  filter = m_filter;
+    m_watcher.setFuture(QtConcurrent::run([snapshot, first, filter]() {
+        FilterResult result;
+        result.end = first + snapshot->size();
+        for (size_t i = 0; i < snapshot->size(); ++i) {
+            if (filter.matches((*snapshot)[i]))
+                result.rows.push_back(first + i);
+        }
+        return result;
+    }));
+    emit filteringChanged(true);
+}
+
+void LogConsoleModel::applyFilterResult()
+{
+    const FilterResult result = m_watcher.result();
+    const quint64      end = m_first + m_records.size();
+
+    beginResetModel();
+    m_rows.clear();
+    for (const quint64 sequence : result.rows) {
+        if (sequence >= m_first)
+            m_rows.push_back(sequence);
+    }
+    for (quint64 sequence = qMax(result.end, m_first); sequence < end; ++sequence) {
+        if (m_filter.matches(record(sequence)))
+            m_rows.push_back(sequence);
+    }
+    endResetModel();
+    emit filteringChanged(false);
+}
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include "logging/ringbufferappender.h"
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+
+#include <deque>
+
+class QTimer;
+
+namespace Log4Qt {
+class Logger;
+}
+
+/*
+* 日志控制台模型：
+*   从 Log::RingBufferAppender 取事件，每 16 毫秒（一帧）批量追加一次，一批只发一次 rowsInserted
+*   最多保留 maxLines 行，超出时移除最旧的行；行内容在 data() 中按需格式化，不预先生成字符串
+*   级别与文本过滤条件变化时在线程池中重新筛选，完成前界面保持旧结果，新到的事件在 GUI 线程中增量筛选
+*
+*  用法：
+*   auto *model = new LogConsoleModel(this);          // 挂到根 logger
+*   model->setFilter(Log4Qt::Level::WARN_INT, "timeout");
+*/
+
+class LogConsoleModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Role
+    {
+        LevelRole = Qt::UserRole + 1,
+        TimeStampRole,
+        LoggerRole,
+        ThreadRole,
+        MessageRole
+    };
+
+    // 创建环形缓冲 Appender 并挂到 logger 上（为空时挂到根 logger），析构时移除
+    explicit LogConsoleModel(QObject *parent = nullptr);
+    explicit LogConsoleModel(Log4Qt::Logger *logger, QObject *parent = nullptr);
+    ~LogConsoleModel() override;
+
+    int      rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    int  maxLines() const { return m_maxLines; }
+    void setMaxLines(int lines);
+
+    // 只显示级别不低于 level 且消息或 logger 名包含 text（不区分大小写）的行
+    void    setFilter(int level, const QString &text);
+    int     filterLevel() const { return m_filter.level; }
+    QString filterText() const { return m_filter.text; }
+
+    // 重新筛选尚未完成
+    bool isFiltering() const { return m_watcher.isRunning(); }
+
+    void clear();
+
+    Log::RingBufferAppender *appender() const { return m_ring; }
+
+signals:
+    void filteringChanged(bool filtering);
+
+private:
+    struct Filter
+    {
+        int     level = 0;
+        QString text;
+
+        bool matches(const Log::LogRecord &record) const;
+    };
+
+    // 重新筛选的结果：快照中符合条件的记录序号
+    struct FilterResult
+    {
+        quint64              end = 0; // 快照之后的记录由 GUI 线程补充筛选
+        std::vector<quint64> rows;
+    };
+
+    void poll();
+    void trim();
+    void startFilter();
+    void applyFilterResult();
+
+    const Log::LogRecord &record(quint64 sequence) const { return m_records[size_t(sequence - m_first)]; }
+
+    Log4Qt::AppenderSharedPtr m_appender;
+    Log::RingBufferAppender  *m_ring;
+    Log4Qt::Logger           *m_logger;
+    QTimer                   *m_timer;
+
+    int                         m_maxLines;
+    std::deque<Log::LogRecord>  m_records;
+    quint64                     m_first; // m_records 第一条记录的序号
+    std::deque<quint64>         m_rows;  // 当前显示的记录序号
+    std::vector<Log::LogRecord> m_batch;
+
+    Filter                       m_filter;
+    QFutureWatcher<FilterResult> m_watcher;
+};
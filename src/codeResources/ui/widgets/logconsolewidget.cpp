@@ -0,0 +1,99 @@
+﻿#include "logconsolewidget.h"
+#include "logconsolemodel.h"
+#include "log4qt/level.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTimer>
+#include <QVBoxLayout>
+
+using namespace Log4Qt;
+
+LogConsoleWidget::LogConsoleWidget(QWidget *parent)
+    : LogConsoleWidget(nullptr, parent)
+{
+}
+
+LogConsoleWidget::LogConsoleWidget(Logger *logger, QWidget *parent)
+    : QWidget(parent)
+    , m_model(new LogConsoleModel(logger, this))
+    , m_view(new QListView(this))
+    , m_level(new QComboBox(this))
+    , m_text(new QLineEdit(this))
+    , m_follow(new QCheckBox(tr("跟随最新"), this))
+    , m_status(new QLabel(this))
+    , m_filterDelay(new QTimer(this))
+    , m_atBottom(true)
+{
+    const QList<Level> levels = {Level(Level::TRACE_INT),
+                                 Level(Level::DEBUG_INT),
+                                 Level(Level::INFO_INT),
+                                 Level(Level::WARN_INT),
+                                 Level(Level::ERROR_INT),
+                                 Level(Level::FATAL_INT)};
+    for (const Level &level : levels)
+        m_level->addItem(level.toString(), level.toInt());
+
+    m_text->setPlaceholderText(tr("过滤关键字"));
+    m_text->setClearButtonEnabled(true);
+    m_follow->setChecked(true);
+
+    // 固定行高，视图不必逐行测量；只有可见行会调用 data()
+    m_view->setModel(m_model);
+    m_view->setUniformItemSizes(true);
+    m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    auto *clearButton = new QPushButton(tr("清空"), this);
+
+    auto *toolbar = new QHBoxLayout;
+    toolbar->addWidget(m_level);
+    toolbar->addWidget(m_text, 1);
+    toolbar->addWidget(m_follow);
+    toolbar->addWidget(clearButton);
+    toolbar->addWidget(m_status);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(toolbar);
+    layout->addWidget(m_view);
+
+    m_filterDelay->setSingleShot(true);
+    m_filterDelay->setInterval(200);
+    connect(m_filterDelay, &QTimer::timeout, this, &LogConsoleWidget::applyFilter);
+    connect(m_text, &QLineEdit::textChanged, m_filterDelay, qOverload<>(&QTimer::start));
+    connect(m_level, qOverload<int>(&QComboBox::currentIndexChanged), this, &LogConsoleWidget::applyFilter);
+    connect(clearButton, &QPushButton::clicked, m_model, &LogConsoleModel::clear);
+    connect(m_model, &LogConsoleModel::filteringChanged, this, [this](bool filtering) {
+        m_status->setText(filtering ? tr("筛选中…") : QString());
+    });
+
+    // 插入前记录是否位于底部，用户向上翻看时不打断
+    connect(m_model, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+        const QScrollBar *bar = m_view->verticalScrollBar();
+        m_atBottom = bar->value() >= bar->maximum();
+    });
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &LogConsoleWidget::onRowsInserted);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &LogConsoleWidget::onRowsInserted);
+}
+
+void LogConsoleWidget::applyFilter()
+{
+    m_filterDelay->stop();
+    m_model->setFilter(m_level->currentData().toInt(), m_text->text().trimmed());
+}
+
+void LogConsoleWidget::onRowsInserted()
+{
+    if (m_follow->isChecked() && m_atBottom)
+        m_view->scrollToBottom();
+}
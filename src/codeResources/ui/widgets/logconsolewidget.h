@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <QWidget>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QListView;
+class QTimer;
+class LogConsoleModel;
+
+namespace Log4Qt {
+class Logger;
+}
+
+/*
+* 应用内日志控制台：
+*   LogConsoleModel + 固定行高的 QListView，只绘制可见行，每秒上万行时界面仍保持流畅
+*   顶部为级别下拉框、关键字输入框（停止输入 200 毫秒后生效）、"跟随最新"开关和清空按钮
+*   "跟随最新"打开且滚动条位于底部时，新行到达后自动滚动到底部
+*
+*  用法：
+*   auto *console = new LogConsoleWidget(this);
+*   console->model()->setMaxLines(50000);
+*/
+
+class LogConsoleWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LogConsoleWidget(QWidget *parent = nullptr);
+    explicit LogConsoleWidget(Log4Qt::Logger *logger, QWidget *parent = nullptr);
+
+    LogConsoleModel *model() const { return m_model; }
+
+private:
+    void applyFilter();
+    void onRowsInserted();
+
+    LogConsoleModel *m_model;
+    QListView       *m_view;
+    QComboBox       *m_level;
+    QLineEdit       *m_text;
+    QCheckBox       *m_follow;
+    QLabel          *m_status;
+    QTimer          *m_filterDelay;
+    bool             m_atBottom;
+};
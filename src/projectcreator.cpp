@@ -442,6 +442,13 @@ bool ProjectCreator::createUIFiles(const QString &projectDir, const QMap<QString
         }
     }
 
+    // 复制通用控件（日志控制台等）
+    QString srcWidgetsDir = QDir::currentPath() + "/codeResources/ui/widgets";
+    QString destWidgetsDir = projectDir + "/ui/widgets";
+    if (!copyDirectory(srcWidgetsDir, destWidgetsDir, false)) {
+        return false;
+    }
+
     return true;
 }
 
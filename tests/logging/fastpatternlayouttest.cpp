@@ -0,0 +1,154 @@
+﻿#include "fastpatternlayout.h"
+#include "log4qt/logger.h"
+#include "log4qt/loggingevent.h"
+#include "log4qt/patternlayout.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+
+#include <cstdio>
+#include <vector>
+
+/*
+* FastPatternLayout 差分测试：
+*   同一模板分别交给 FastPatternLayout 与 log4qt 的 PatternLayout，逐条比对输出。
+*   FastPatternLayout 内部自检不一致时会静默改为调用 PatternFormatter，输出仍然一致，
+*   所以这里同时要求模板整体已编译且没有转换器被降级，保证比对的确实是快速路径
+*/
+
+using namespace Log4Qt;
+
+namespace {
+// 覆盖对齐、截断、各种日期写法以及字面量转义
+const QStringList kPatterns = {
+    QStringLiteral("%d{yyyy-MM-dd hh:mm:ss.zzz} [%-5p] %c - %m%n"),
+    QStringLiteral("%10m|%-10m|%.5m|%10.5m|%-10.5m|%n"),
+    QStringLiteral("%5.5p|%-5.3p|%.1p|%-20.30c|%.4c|%n"),
+    QStringLiteral("[%.3t][%-12.6t][%8x][%-8.3x][%20X{requestId}][%-6.2X{requestId}]%n"),
+    QStringLiteral("%F:%5L %-10.8M %.6F %-4L%n"),
+    QStringLiteral("%r %8r %-8.4r %m%n"),
+    QStringLiteral("%d %m%n"),
+    QStringLiteral("%d{ISO8601} %m%n"),
+    QStringLiteral("%d{ABSOLUTE} %m%n"),
+    QStringLiteral("%d{DATE} %m%n"),
+    QStringLiteral("%d{NONE}|%d{RELATIVE} %m%n"),
+    QStringLiteral("%d{yyyy-MM-dd hh:mm:ss,zzz} %m%n"),
+    QStringLiteral("%d{hh:mm:ss} %m%n"),
+    QStringLiteral("%d{zzz} %d{ss} %m%n"),
+    QStringLiteral("%d{z} %m%n"),
+    QStringLiteral("%d{ss.zzz zzz} %m%n"),
+    QStringLiteral("%d{dd.MM.yyyy hh:mm} %%literal%% %p%n"),
+    QStringLiteral("%30d{ISO8601}|%-30d{ABSOLUTE}|%.8d{yyyy-MM-dd hh:mm:ss.zzz}|%n"),
+};
+
+// 毫秒与秒的边界：整秒、跨秒、跨分钟、跨天，以及时间回退（缓存必须失效）
+std::vector<qint64> boundaryTimes()
+{
+    const qint64 base = QDateTime(QDate(2024, 2, 29), QTime(23, 59, 59)).toMSecsSinceEpoch();
+    const qint64 offsets[] = {0,     1,     9,     10,    99,       100,      111,      500,  998, 999,
+                              1000,  1001,  1010,  1999,  2000,     999,      0,        -1,   -999, -1000,
+                              -1001, 59999, 60000, 60001, 86399999, 86400000, 86400001, 1,    1};
+    std::vector<qint64> times;
+    for (const qint64 offset : offsets)
+        times.push_back(base + offset);
+    times.push_back(QDateTime::currentMSecsSinceEpoch());
+    return times;
+}
+
+std::vector<LoggingEvent> testEvents()
+{
+    const Logger                 *logger = Logger::logger(QStringLiteral("Test.Layout.VeryLongLoggerNameForTruncation"));
+    const QString                 longText(80, QLatin1Char('z'));
+    const QHash<QString, QString> requestId{{QStringLiteral("requestId"), QStringLiteral("req-0123456789")}};
+    const Level                   levels[] = {Level(Level::TRACE_INT),
+                                              Level(Level::DEBUG_INT),
+                                              Level(Level::INFO_INT),
+                                              Level(Level::WARN_INT),
+                                              Level(Level::ERROR_INT),
+                                              Level(Level::FATAL_INT)};
+
+    std::vector<LoggingEvent> events;
+    int                       index = 0;
+    for (const qint64 time : boundaryTimes()) {
+        const Level level = levels[index % 6];
+        switch (index++ % 4) {
+        case 0:
+            events.emplace_back(logger,
+                                level,
+                                QStringLiteral("abcdefghijklmnop"),
+                                QStringLiteral("session-7"),
+                                requestId,
+                                QStringLiteral("worker-thread-1"),
+                                time,
+                                MessageContext("layouttest.cpp", 1234, "void Test::run()"),
+                                QString());
+            break;
+        case 1:
+            events.emplace_back(logger,
+                                level,
+                                QStringLiteral("abc"),
+                                QString(),
+                                QHash<QString, QString>(),
+                                QString(),
+                                time,
+                                MessageContext(),
+                                QString());
+            break;
+        case 2:
+            events.emplace_back(logger,
+                                level,
+                                longText,
+                                longText,
+                                QHash<QString, QString>{{QStringLiteral("requestId"), longText}},
+                                longText,
+                                time,
+                                MessageContext("", 0, ""),
+                                QString());
+            break;
+        default:
+            events.emplace_back(logger, level, QString::fromUtf8("中文消息 \xF0\x9F\x98\x80"), time);
+            break;
+        }
+    }
+    return events;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const std::vector<LoggingEvent> events = testEvents();
+    int                             failures = 0;
+    for (const QString &pattern : kPatterns) {
+        Log::FastPatternLayout fast(pattern);
+        PatternLayout          reference(pattern);
+        const QByteArray       name = pattern.toLocal8Bit();
+
+        if (!fast.isCompiled() || fast.downgradedCount() != 0) {
+            ++failures;
+            std::printf("FAIL '%s': not fully compiled (compiled=%d, downgraded=%d)\n",
+                        name.constData(),
+                        int(fast.isCompiled()),
+                        fast.downgradedCount());
+        }
+        // 两遍：第一遍建立日期缓存，第二遍命中缓存
+        for (int pass = 0; pass < 2; ++pass) {
+            for (const LoggingEvent &event : events) {
+                const QString expected = reference.format(event);
+                const QString actual = fast.format(event);
+                if (actual == expected)
+                    continue;
+                ++failures;
+                std::printf("FAIL '%s' at %lld:\n  expected: %s\n  actual:   %s\n",
+                            name.constData(),
+                            static_cast<long long>(event.timeStamp()),
+                            expected.toLocal8Bit().constData(),
+                            actual.toLocal8Bit().constData());
+            }
+        }
+    }
+
+    std::printf("%d patterns, %d events, %d failures\n", int(kPatterns.size()), int(events.size()), failures);
+    return failures ? 1 : 0;
+}
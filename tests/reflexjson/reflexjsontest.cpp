@@ -0,0 +1,251 @@
+﻿#include <QtCore/QString>
+
+#include "obj_conv/reflex_format.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <sstream>
+
+/*
+* reflexjson 差分测试：
+*   json_to_obj 改用流式的 JsonSaxReader 后，转换结果应与原来的 JsonReader（DOM）一致。
+*   同一输入分别交给两者，比对返回值与读出的对象；语法错误与根节点后的多余内容只检查 SAX，
+*   JsonReader 解析失败后不能继续使用
+*/
+
+using namespace reflexjson;
+
+namespace {
+struct Item
+{
+    int              id = -1;
+    std::string      name = "preset";
+    double           score = 0.5;
+    bool             flag = false;
+    std::vector<int> tags;
+
+    REFLEX_BIND(O(id, name, score, flag, tags))
+};
+
+struct Choice
+{
+    int id = 0;
+    int value = 0;
+
+    REFLEX_BIND(O(id, value))
+};
+
+struct Document
+{
+    int                          version = 0;
+    Item                         item;
+    std::vector<Item>            items;
+    Choice                       choice;
+    std::map<std::string, int>   counts;
+    std::list<int>               ids;
+    std::set<std::string>        labels;
+    std::tuple<int, std::string> pair;
+    std::shared_ptr<Item>        shared;
+    uint64_t                     big = 0;
+    std::vector<char>            text;
+
+    REFLEX_BIND(O(version, item, items, choice, counts, ids, labels, pair, shared, big, text))
+};
+
+// condition_t：从数组中选出 id 为 2 的元素
+bool chooseSecond(void *, void *doc)
+{
+    int id = 0;
+    static_cast<JsonReader *>(doc)->convert("id", id);
+    return id == 2;
+}
+
+std::string describe(const Item &item)
+{
+    std::ostringstream out;
+    out << "{id=" << item.id << ",name=" << item.name << ",score=" << item.score << ",flag=" << item.flag << ",tags=[";
+    for (const int tag : item.tags)
+        out << tag << ',';
+    out << "]}";
+    return out.str();
+}
+
+std::string describe(const Document &doc)
+{
+    std::ostringstream out;
+    out << "version=" << doc.version << " item=" << describe(doc.item) << " items=[";
+    for (const Item &item : doc.items)
+        out << describe(item) << ',';
+    out << "] choice={" << doc.choice.id << ',' << doc.choice.value << "} counts={";
+    for (const auto &count : doc.counts)
+        out << count.first << ':' << count.second << ',';
+    out << "} ids=[";
+    for (const int id : doc.ids)
+        out << id << ',';
+    out << "] labels=[";
+    for (const std::string &label : doc.labels)
+        out << label << ',';
+    out << "] pair=(" << std::get<0>(doc.pair) << ',' << std::get<1>(doc.pair) << ") shared="
+        << (doc.shared ? describe(*doc.shared) : std::string("null")) << " big=" << doc.big << " text="
+        << std::string(doc.text.begin(), doc.text.end());
+    return out.str();
+}
+
+std::string describe(const std::vector<Item> &items)
+{
+    std::string out = "[";
+    for (const Item &item : items)
+        out += describe(item) + ',';
+    return out + ']';
+}
+
+std::string describe(const std::vector<int> &values)
+{
+    std::string out = "[";
+    for (const int value : values)
+        out += std::to_string(value) + ',';
+    return out + ']';
+}
+
+template<typename _type>
+struct Case
+{
+    const char                   *name;
+    std::string                   json;
+    std::function<void(_type &)> prepare;
+};
+
+void prepareDocument(Document &doc)
+{
+    doc.choice.cond_t_.set_value(nullptr, &chooseSecond);
+    doc.items.resize(3);
+    doc.items[0].tags = {7, 8};
+}
+
+template<typename _type>
+int compare(const std::vector<Case<_type>> &cases)
+{
+    int failures = 0;
+    for (const Case<_type> &test : cases) {
+        _type dom;
+        _type sax;
+        if (test.prepare) {
+            test.prepare(dom);
+            test.prepare(sax);
+        }
+
+        JsonReader reader(test.json);
+        const bool expected = reader.convert(nullptr, dom);
+        const bool actual = json_to_obj(test.json, sax).first;
+        if (expected == actual && describe(dom) == describe(sax))
+            continue;
+        ++failures;
+        std::printf("FAIL '%s':\n  dom: %d %s\n  sax: %d %s\n",
+                    test.name,
+                    int(expected),
+                    describe(dom).c_str(),
+                    int(actual),
+                    describe(sax).c_str());
+    }
+    return failures;
+}
+
+const std::vector<Case<Document>> kDocumentCases = {
+    {"declaration order",
+     R"({"version":1,"item":{"id":1,"name":"a","score":1.5,"flag":true,"tags":[1,2]},"items":[{"id":2},{"id":3}],
+        "choice":{"id":5,"value":50},"counts":{"x":1,"y":2},"ids":[4,5],"labels":["b","a"],"pair":[9,"nine"],
+        "shared":{"id":6},"big":18446744073709551615,"text":"abc"})",
+     prepareDocument},
+    {"reordered keys",
+     R"({"text":"abc","big":1,"shared":{"tags":[3],"id":6},"pair":[9,"nine"],"labels":["a"],"ids":[4],
+        "counts":{"y":2},"choice":{"value":50,"id":5},"items":[{"name":"n","id":2}],
+        "item":{"tags":[1],"flag":1,"score":2,"name":"a","id":1},"version":1})",
+     prepareDocument},
+    {"duplicate keys",
+     R"({"version":1,"version":2,"item":{"id":1,"id":2,"name":"first","name":"second"},
+        "item":{"id":3},"items":[{"id":4}],"items":[{"id":5},{"id":6}],"big":1,"big":2})",
+     prepareDocument},
+    {"duplicate keys after cursor",
+     R"({"item":{"name":"a","id":1,"name":"b","tags":[1],"id":2,"tags":[2,3]},"version":7,"item":{"id":9}})",
+     prepareDocument},
+    {"null before duplicate", R"({"version":null,"version":3,"item":null,"item":{"id":4}})", prepareDocument},
+    {"missing keys", R"({"item":{"name":"only"}})", prepareDocument},
+    {"empty object", R"({})", prepareDocument},
+    {"null values",
+     R"({"version":null,"item":{"id":null,"name":null,"score":null,"flag":null,"tags":null},"items":null,
+        "choice":null,"counts":null,"ids":null,"labels":null,"pair":null,"shared":null,"big":null,"text":null})",
+     prepareDocument},
+    {"mistyped scalars",
+     R"({"version":"1","item":{"id":1.5,"name":7,"score":"x","flag":2,"tags":[1,"2",3]},"big":-1,"text":5})",
+     prepareDocument},
+    {"mistyped containers",
+     R"({"items":"none","ids":{"a":1},"labels":7,"pair":{"x":1},"item":{"tags":{"a":1}}})",
+     prepareDocument},
+    {"struct bound to scalar", R"({"item":5,"shared":"x","choice":true})", prepareDocument},
+    {"struct bound to short array", R"({"item":[],"shared":[{"id":3}]})", prepareDocument},
+    {"struct bound to long array without condition", R"({"item":[{"id":1},{"id":2}]})", prepareDocument},
+    {"condition selects", R"({"choice":[{"id":1,"value":10},{"id":2,"value":20},{"id":3,"value":30}]})", prepareDocument},
+    {"condition without match", R"({"choice":[{"id":1,"value":10},{"id":3,"value":30}]})", prepareDocument},
+    {"condition with one element", R"({"choice":[{"id":2,"value":20}]})", prepareDocument},
+    {"condition bound to object", R"({"choice":{"id":4,"value":40}})", prepareDocument},
+    {"shorter array keeps leading elements", R"({"items":[{"name":"x"},{"tags":[]}]})", prepareDocument},
+    {"unknown keys",
+     R"({"skip":{"a":[1,{"b":null}],"c":"d"},"version":2,"more":[[],{}],"item":{"extra":{"id":9},"id":3}})",
+     prepareDocument},
+    {"tuple longer than array", R"({"pair":[1,"one",2,3],"ids":[1,2,3]})", prepareDocument},
+    {"root is array", R"([{"version":1}])", prepareDocument},
+    {"root is scalar", R"(42)", prepareDocument},
+};
+
+const std::vector<Case<std::vector<Item>>> kItemListCases = {
+    {"root vector", R"([{"id":1,"name":"a"},{"name":"b","id":2},{}])", nullptr},
+    {"root vector with duplicates", R"([{"id":1,"id":2}])", nullptr},
+    {"root vector bound to object", R"({"id":1})", nullptr},
+    {"root vector bound to null", R"(null)", nullptr},
+    {"root vector shrinks", R"([{"id":5}])", [](std::vector<Item> &items) { items.resize(4); }},
+};
+
+const std::vector<Case<std::vector<int>>> kIntListCases = {
+    {"root ints", R"([1,2,3])", nullptr},
+    {"root ints mistyped", R"([1,"2",null,4.5,5])", nullptr},
+    {"root ints bound to scalar", R"(7)", [](std::vector<int> &values) { values = {1, 2}; }},
+};
+
+// 只有 SAX 能报告的错误：语法错误、根节点后的多余内容
+const char *const kErrorInputs[] = {
+    R"({"version":1} x)",
+    R"({"version":1}{"version":2})",
+    R"({"version":1,)",
+    R"({"version":1)",
+    R"([{"version":1}] 0)",
+    "",
+};
+
+int checkErrors()
+{
+    int failures = 0;
+    for (const char *input : kErrorInputs) {
+        Document doc;
+        prepareDocument(doc);
+        if (!json_to_obj(std::string(input), doc).first)
+            continue;
+        ++failures;
+        std::printf("FAIL '%s': expected failure\n", input);
+    }
+    return failures;
+}
+} // namespace
+
+int main()
+{
+    int failures = compare(kDocumentCases);
+    failures += compare(kItemListCases);
+    failures += compare(kIntListCases);
+    failures += checkErrors();
+
+    std::printf("%d cases, %d failures\n",
+                int(kDocumentCases.size() + kItemListCases.size() + kIntListCases.size() + std::size(kErrorInputs)),
+                failures);
+    return failures ? 1 : 0;
+}